@@ -4,6 +4,9 @@
 
 #ifndef APPOINTMENT_H
 #define APPOINTMENT_H
+
+#include "rowindex.h"
+
 typedef struct {
     int appointmentId;
     int patientId;
@@ -25,5 +28,6 @@ void listAllAppointments();
 void editAppointment(int appointmentId, Appointment* appointment);
 void deleteAppointment(int appointmentId);
 void appointmentInformationLookup();
+RowIndex* getAppointmentPatientIndex();
 
 #endif //APPOINTMENT_H
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef BILLING_H
+#define BILLING_H
+
+#include "hashmap.h"
+#include "money.h"
+
+#define APPOINTMENT_FEE MONEY_FROM_TAKA(500)
+#define EMERGENCY_BASE_FEE MONEY_FROM_TAKA(200)
+
+typedef struct {
+    int medicineId;
+    char name[50];
+    Money price;
+} BillingPrice;
+
+typedef struct {
+    int emergencyId;
+    int medicineId;
+    int quantity;
+    int next;           // Next line for the same emergency visit, -1 at the end
+} BillingMedicineLine;
+
+// Lookup tables built once per billing run so every source file is read
+// exactly once, regardless of how many visits or medicine lines it has.
+typedef struct {
+    BillingPrice* prices;
+    int priceCount;
+    IntMap priceIndex;      // medicineId -> index into prices
+
+    BillingMedicineLine* lines;
+    int lineCount;
+    IntMap lineHeads;       // emergencyId -> first line
+    IntMap lineTails;       // emergencyId -> last line
+} BillingEngine;
+
+void loadBillingEngine(BillingEngine* engine);
+void loadBillingPriceTable(BillingEngine* engine);
+void freeBillingEngine(BillingEngine* engine);
+const BillingPrice* findBillingPrice(const BillingEngine* engine, int medicineId);
+int firstEmergencyMedicineLine(const BillingEngine* engine, int emergencyId);
+
+// Batch billing
+int generateBatchBills(int fromDate, int toDate);
+void runBatchBilling();
+
+#endif //BILLING_H
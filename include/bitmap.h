@@ -0,0 +1,19 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+// Growable set of row numbers, one bit per row, so filters over the same
+// rows combine with a word-wise AND instead of a scan.
+// A zero-initialized RowBitmap is a valid empty set.
+typedef struct {
+    unsigned long long* words;
+    int wordCount;
+} RowBitmap;
+
+void clearRowBitmap(RowBitmap* bitmap);
+void setRowBit(RowBitmap* bitmap, int row);
+void copyRowBitmap(RowBitmap* into, const RowBitmap* from);
+void intersectRowBitmaps(RowBitmap* into, const RowBitmap* with);
+int countRowBits(const RowBitmap* bitmap);
+int nextSetRow(const RowBitmap* bitmap, int from);
+
+#endif //BITMAP_H
@@ -0,0 +1,24 @@
+#ifndef CONSUMPTION_FORECAST_H
+#define CONSUMPTION_FORECAST_H
+
+#define FORECAST_HORIZON_DAYS 365
+
+// Daily consumption of one medicine, folded one closed day at a time from
+// prescriptions and emergency treatments. The average is exponentially
+// weighted so recent days count most; the weekday sums decay the same way
+// and give each day of the week its share of the demand.
+typedef struct {
+    int medicineId;
+    int currentDate;            // Latest day seen, still open for more units
+    int currentDayUnits;
+    double averageDailyUnits;   // Over closed days, weekday adjusted
+    int closedDays;
+    double weekdayUnits[7];     // Indexed 0 = Sunday
+    double weekdayWeight[7];
+} MedicineConsumption;
+
+void refreshConsumptionForecast();
+void resetConsumptionForecast();
+int getDaysOfStockRemaining(int medicineId, int quantity);
+
+#endif //CONSUMPTION_FORECAST_H
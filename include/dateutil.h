@@ -0,0 +1,16 @@
+#ifndef DATEUTIL_H
+#define DATEUTIL_H
+
+#include <stddef.h>
+#include <time.h>
+
+// Dates are packed as YYYYMMDD integers so they compare and sort numerically
+int packDate(const char* date);
+void unpackDate(int packedDate, char* date, size_t size);
+int getTodayPackedDate();
+int addDaysToPackedDate(int packedDate, int days);
+int daysBetweenPackedDates(int fromDate, int toDate);
+int getPackedDateWeekday(int packedDate);
+time_t parseDateTime(const char* date, const char* time);
+
+#endif //DATEUTIL_H
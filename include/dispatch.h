@@ -0,0 +1,31 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "emergency.h"
+
+#define MAX_DOCTOR_SPECIALTIES 4
+#define GENERAL_SPECIALTY "General"
+
+typedef struct {
+    char name[50];
+    char specialties[MAX_DOCTOR_SPECIALTIES][30];
+    int specialtyCount;
+    int maxPatients;        // Patients the doctor can treat at once
+    int currentPatients;
+} EmergencyDoctor;
+
+typedef struct {
+    EmergencyDoctor* doctors;
+    int count;
+} EmergencyRoster;
+
+int loadEmergencyRoster(EmergencyRoster* roster);
+void freeEmergencyRoster(EmergencyRoster* roster);
+const char* inferEmergencySpecialty(const char* symptoms);
+int chooseEmergencyDoctor(const EmergencyRoster* roster, const char* specialty, EmergencyPriority priority);
+
+int dispatchWaitingPatients(EmergencyRoster* roster);
+void simulateEmergencyDay(int packedDate);
+void doctorDispatchMenu();
+
+#endif //DISPATCH_H
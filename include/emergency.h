@@ -1,7 +1,9 @@
 #ifndef EMERGENCY_H
 #define EMERGENCY_H
 
-#define MAX_EMERGENCY_QUEUE 50
+#include <time.h>
+#include "rowindex.h"
+
 #define MAX_EMERGENCY_MEDICINES 10
 
 typedef enum {
@@ -35,31 +37,23 @@ typedef struct {
     int medicineCount;
     char dischargeTime[9];
     char notes[300];
+    unsigned int arrivalSequence;   // FIFO order within a priority level
+    time_t arrivalEpoch;            // Parsed from arrivalDate/arrivalTime when queued
+    EmergencyPriority effectivePriority;    // Triage priority after aging
+    time_t treatmentStartEpoch;     // First claimed for treatment, 0 while never treated
 } EmergencyPatient;
 
-typedef struct {
-    EmergencyPatient patients[MAX_EMERGENCY_QUEUE];
-    int front;
-    int rear;
-    int count;
-} EmergencyQueue;
-
-// Queue operations
-void initializeEmergencyQueue();
-int isEmergencyQueueEmpty();
-int isEmergencyQueueFull();
-void enqueueEmergencyPatient(EmergencyPatient patient);
-EmergencyPatient dequeueEmergencyPatient();
-void sortQueueByPriority();
-
 // Emergency management functions
 void emergencyPatientQueue();
-EmergencyPatient createEmergencyEntry();
+int createEmergencyEntry(EmergencyPatient* patient);
 void addPatientToEmergencyQueue();
+void batchEmergencyIntake();
 void viewEmergencyQueue();
 void treatNextPatient();
 void dischargePatient();
 void searchEmergencyPatient();
+void retriageEmergencyPatient();
+void configurePriorityAging();
 void addMedicineToTreatment(EmergencyPatient* patient);
 void scheduleFollowUpAppointment(const EmergencyPatient* patient);
 void generateEmergencyReport();
@@ -67,9 +61,12 @@ void viewPatientTreatmentHistory();
 
 // Utility functions
 int generateEmergencyId();
+int parseEmergencyRecord(const char* line, EmergencyPatient* patient);
+void recoverEmergencyQueue();
 void getCurrentDateTime(char* date, char* time);
 const char* getPriorityString(EmergencyPriority priority);
 void showEmergencyPatient(EmergencyPatient* patient);
-void saveEmergencyRecord(EmergencyPatient* patient);
+int saveEmergencyRecord(EmergencyPatient* patient);
+RowIndex* getEmergencyPatientIndex();
 
 #endif //EMERGENCY_H
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef EMERGENCY_MEDICINES_H
+#define EMERGENCY_MEDICINES_H
+
+#include "emergency.h"
+
+// Each save appends a visit's full medicine list as one contiguous block of
+// rows; the index maps an emergencyId to its most recent block.
+int appendEmergencyMedicines(int emergencyId, const EmergencyMedicine* medicines, int count);
+int findEmergencyMedicines(int emergencyId, EmergencyMedicine* medicines, int maxMedicines);
+void refreshEmergencyMedicineIndex();
+int getEmergencyMedicineBlock(int emergencyId, long* offset, long* length);
+
+#endif //EMERGENCY_MEDICINES_H
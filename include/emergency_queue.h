@@ -0,0 +1,88 @@
+#ifndef EMERGENCY_QUEUE_H
+#define EMERGENCY_QUEUE_H
+
+#include "emergency.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#define EMERGENCY_BOARD_INITIAL_SLOTS 64
+#define DEFAULT_EMERGENCY_AGING_MINUTES 30
+#define FIRST_EMERGENCY_ID 5001
+
+// Heap entries are small keys pointing at a record slot, so reordering
+// never moves the EmergencyPatient records themselves.
+typedef struct {
+    int priority;
+    unsigned int sequence;  // FIFO order within a priority level
+    int slot;
+} EmergencyQueueEntry;
+
+// One board slot holds a patient record, heap entry `i` of the queue
+// (which may belong to another slot), and bucket `i` of the ID hash.
+// Keeping everything per slot lets the board grow by appending slots.
+typedef struct {
+    EmergencyPatient patient;
+    int inUse;
+    int heapPosition;       // -1 when not queued
+    int nextFree;           // Free list link, -1 at the end
+    int nextInBucket;       // ID hash chain, -1 at the end
+    int bucketHead;         // First slot in hash bucket `i`, -1 if empty
+    EmergencyQueueEntry heapEntry;
+} EmergencyBoardSlot;
+
+// The live queue. On POSIX systems it sits in shared memory so every
+// terminal working from the same data directory sees and updates one
+// queue; elsewhere each process keeps a private board.
+typedef struct {
+    unsigned int magic;
+    unsigned int slotSize;  // Rejects boards left by a build with another layout
+    int ready;              // Set once the creating terminal has filled it
+    int retired;            // Set by the last terminal to leave before unlinking
+    int attachCount;
+#ifndef _WIN32
+    pthread_mutex_t lock;
+#endif
+
+    int capacity;
+    int firstFree;
+    int count;              // Queued patients (heap size)
+    unsigned int nextSequence;
+
+    int agingMinutes;       // Wait per one-level promotion, 0 disables aging
+    time_t nextAgingDue;    // Earliest pending promotion, 0 if none
+
+    int lastEmergencyId;
+    int nextTempPatientId;
+
+    EmergencyBoardSlot slots[];
+} EmergencyBoard;
+
+int initializeEmergencyQueue();
+void publishEmergencyQueue();
+int isEmergencyQueueShared();
+int isEmergencyQueueEmpty();
+int getEmergencyQueueCount();
+int getEmergencyBoardCount();
+
+int enqueueEmergencyPatient(const EmergencyPatient* patient);
+int enqueueEmergencyPatients(const EmergencyPatient* patients, int count);
+int updateEmergencyPatient(const EmergencyPatient* patient);
+int claimNextEmergencyPatient(EmergencyPatient* patient);
+int claimEmergencyPatient(int emergencyId, const char* doctor, EmergencyPatient* patient);
+int findEmergencyPatient(int emergencyId, EmergencyPatient* patient);
+int removeEmergencyPatient(int emergencyId);
+int changeEmergencyPriority(int emergencyId, EmergencyPriority priority, EmergencyPatient* patient);
+EmergencyPatient* copyEmergencyQueue(int* count);
+EmergencyPatient* copyEmergencyBoard(int* count);
+
+int getEmergencyAgingInterval();
+int setEmergencyAgingInterval(int minutes);
+
+int takeNextEmergencyId();
+int takeNextTempPatientId();
+void raiseEmergencyIdFloor(int maxEmergencyId, int nextTempPatientId);
+void getEmergencyIdCounters(int* maxEmergencyId, int* nextTempPatientId);
+
+#endif //EMERGENCY_QUEUE_H
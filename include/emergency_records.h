@@ -0,0 +1,20 @@
+#ifndef EMERGENCY_RECORDS_H
+#define EMERGENCY_RECORDS_H
+
+#include "emergency.h"
+
+// emergency.csv is an append-only log: every save appends the visit's full
+// row, and the index maps an emergencyId to its latest row. Superseded rows
+// stay in the file until compaction drops them, so readers scanning the
+// file must skip rows that are not current.
+#define EMERGENCY_COMPACTION_MIN_STALE 256
+
+void refreshEmergencyRecordIndex();
+int appendEmergencyRecord(const EmergencyPatient* patient);
+int appendEmergencyRecords(const EmergencyPatient* patients, int count);
+int findEmergencyRecord(int emergencyId, EmergencyPatient* patient);
+int isCurrentEmergencyRecord(int emergencyId, long offset);
+int isCurrentEmergencyRow(const char* row, long offset);
+int compactEmergencyRecords();
+
+#endif //EMERGENCY_RECORDS_H
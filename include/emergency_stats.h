@@ -0,0 +1,40 @@
+#ifndef EMERGENCY_STATS_H
+#define EMERGENCY_STATS_H
+
+#include "emergency.h"
+
+// Log-bucketed histogram: bucket i holds values in (gamma^(i-1), gamma^i],
+// so any quantile is within SKETCH_RELATIVE_ACCURACY of the true value and
+// two sketches merge by adding their buckets.
+#define SKETCH_RELATIVE_ACCURACY 0.02
+#define SKETCH_BUCKETS 320
+
+typedef struct {
+    unsigned int zeroCount;     // Values below one minute
+    unsigned int counts[SKETCH_BUCKETS];
+    unsigned int total;
+} QuantileSketch;
+
+typedef struct {
+    QuantileSketch waitToTreatment[LOW + 1];    // Minutes, indexed by priority
+    QuantileSketch lengthOfStay[LOW + 1];       // Arrival to discharge, minutes
+    unsigned int arrivalsByHour[24];
+    int arrivalDays;
+    int lastArrivalDate;
+    long eventsOffset;          // How much of the event log is folded in
+} EmergencyStats;
+
+void addSketchValue(QuantileSketch* sketch, double value);
+void mergeQuantileSketch(QuantileSketch* into, const QuantileSketch* from);
+double getSketchQuantile(const QuantileSketch* sketch, double quantile);
+
+void initializeEmergencyStats();
+void recordEmergencyArrival(const EmergencyPatient* patient);
+void recordEmergencyArrivals(const EmergencyPatient* patients, int count);
+void recordEmergencyTreatmentStart(const EmergencyPatient* patient);
+void recordEmergencyDischarge(int emergencyId, EmergencyPriority priority, const char* arrivalDate,
+                              const char* arrivalTime, time_t dischargedAt);
+int loadEmergencyStats(EmergencyStats* stats);
+void printEmergencyAnalytics();
+
+#endif //EMERGENCY_STATS_H
@@ -0,0 +1,22 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+// Open-addressing hash map from int keys to int values.
+// A zero-initialized IntMap is a valid empty map.
+typedef struct {
+    int* keys;
+    int* values;
+    unsigned char* states;  // 0 = empty, 1 = used, 2 = deleted
+    int capacity;
+    int count;
+    int tombstones;
+} IntMap;
+
+void initIntMap(IntMap* map, int expectedCount);
+void freeIntMap(IntMap* map);
+void clearIntMap(IntMap* map);
+void intMapPut(IntMap* map, int key, int value);
+int intMapGet(const IntMap* map, int key, int* value);
+int intMapRemove(IntMap* map, int key);
+
+#endif //HASHMAP_H
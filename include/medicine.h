@@ -6,17 +6,25 @@
 #ifndef MEDICINE_H
 #define MEDICINE_H
 
+#include "money.h"
+
 typedef struct {
     int medicineId;
     char name[50];
     char category[30];      // Antibiotic, Painkiller, etc.
     int quantity;
-    float price;
-    char expiryDate[12];    // DD/MM/YYYY
+    Money price;
+    int expiryDate;         // Packed YYYYMMDD (see dateutil.h), 0 if unknown
     char manufacturer[50];
     char description[200];
 } Medicine;
 
+typedef struct {
+    const char* name;
+    int medicineCount;
+    int unitsInStock;
+} CategoryFacet;
+
 // Function declarations
 void initializeMaxMedicineId();
 int generateMedicineId();
@@ -25,10 +33,27 @@ Medicine makeMedicine();
 void makeMedicineEntry(Medicine* medicine);
 void searchMedicine();
 Medicine findMedicine(int medicineId);
+const Medicine* lookupMedicine(int medicineId);
+const Medicine* getMedicineCatalog(int* count);
+void invalidateMedicineCatalog();
+int reserveMedicineStock(int medicineId, int quantity, int* available);
+int adjustMedicineStock(int medicineId, int change, int* available);
 void updateMedicineStock();
 void listAllMedicines();
 void listLowStockMedicines();
 void deleteMedicine(int medicineId);
+void showStockMovementHistory();
+void listExpiringMedicines();
+void setMedicineReorderPoint();
+void browseMedicineCategories();
+void receiveShipment();
+int findExpiringMedicines(int cutoffDate, const Medicine** medicines, int maxCount);
+int findLowStockMedicines(int threshold, const Medicine** medicines, int maxCount);
+int searchMedicines(const char* query, const Medicine** medicines, int maxCount);
+int getCategoryFacets(CategoryFacet* facets, int maxCount);
+int findCategoryMedicines(const char* category, int belowStock, int expiringBy,
+                          const Medicine** medicines, int maxCount);
+Medicine chooseMedicineLot(const Medicine* medicine);
 
 
 #endif //MEDICINE_H
@@ -0,0 +1,20 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Amounts are whole paisa, so sums are exact and come out the same in any
+// order. The data files keep the "123.45" taka text they always had.
+typedef int64_t Money;
+
+#define MONEY_SCALE 100
+#define MONEY_TEXT_SIZE 24
+#define MONEY_FROM_TAKA(taka) ((Money)(taka) * MONEY_SCALE)
+
+int parseMoney(const char* text, Money* amount);
+void formatMoney(Money amount, char* text, size_t size);
+Money sumMoney(const Money* amounts, int count);
+void sumMoneyByGroup(const int* groups, const Money* amounts, int count, Money* totals);
+
+#endif //MONEY_H
@@ -4,14 +4,18 @@
 
 #ifndef PRESCRIPTION_H
 #define PRESCRIPTION_H
+
+#include "rowindex.h"
+#include "money.h"
+
 typedef struct {
     int prescriptionId;
     int patientId;
     int medicineId;
     char medicineName[50];
     int quantity;
-    float unitPrice;
-    float totalPrice;
+    Money unitPrice;
+    Money totalPrice;
     char prescribedDate[20];
     char prescribedBy[50];
     char dosage[100];
@@ -22,7 +26,7 @@ typedef struct {
 // Function prototypes
 void initializeMaxPrescriptionId();
 int generatePrescriptionId();
-void savePrescription(Prescription* prescription);
+int savePrescription(Prescription* prescription);
 void addPrescription();
 void viewPatientPrescriptions();
 void viewAllPrescriptions();
@@ -31,4 +35,6 @@ void prescriptionManagement();
 Prescription findPrescriptionById(int prescriptionId);
 void editPrescription(int prescriptionId);
 void searchPrescriptionByPatient(int patientId);
+int parsePrescriptionLine(const char* line, Prescription* prescription);
+RowIndex* getPrescriptionPatientIndex();
 #endif //PRESCRIPTION_H
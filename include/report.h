@@ -1,6 +1,8 @@
 #ifndef REPORT_H
 #define REPORT_H
 
+#include "money.h"
+
 typedef enum {
     PATIENT_PROFILE = 1,
     APPOINTMENT_HISTORY = 2,
@@ -25,12 +27,12 @@ typedef struct {
     int patientId;
     char patientName[50];
     char billDate[20];
-    float medicineTotal;
-    float consultationFee;
-    float emergencyFee;
-    float tax;
-    float discount;
-    float grandTotal;
+    Money medicineTotal;
+    Money consultationFee;
+    Money emergencyFee;
+    Money tax;
+    Money discount;
+    Money grandTotal;
     char paymentStatus[20];
     char paymentMethod[20];
     char notes[200];
@@ -46,8 +48,6 @@ void generatePrescriptionReport();
 void generateBillingReport();
 void viewAllReports();
 void deleteReport();
-static void printEmergencyHistory(int patientId, FILE* reportFp);
-static void printPrescriptionHistory(int patientId, FILE* reportFp);;
 // Billing functions
 void billingManagement();
 void generatePatientBill();
@@ -58,9 +58,11 @@ void updatePaymentStatus();
 // Utility functions
 int generateReportId();
 int generatePrescriptionId();
+void initializeMaxBillId();
 int generateBillId();
 void saveReport(Report* report);
 void saveBill(Bill* bill);
+void writeBillRecord(FILE* fp, const Bill* bill);
 Bill findBill(int billId);
 
 #endif //REPORT_H
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef ROWINDEX_H
+#define ROWINDEX_H
+
+#include <stdio.h>
+#include "hashmap.h"
+
+// Secondary index from an integer CSV column to the byte offsets of the
+// rows holding it. Rows for a key are chained in file order. The index is
+// built on first use, extended when rows are appended, and discarded when
+// the file is rewritten.
+typedef struct {
+    const char* path;
+    int keyColumn;          // 0-based CSV column holding the key
+    IntMap heads;           // key -> first entry
+    IntMap tails;           // key -> last entry
+    long* offsets;
+    int* next;
+    int count;
+    int capacity;
+    long indexedSize;       // Bytes of the file covered by the index
+    int isBuilt;
+} RowIndex;
+
+void invalidateRowIndex(RowIndex* index);
+void noteRowAppended(RowIndex* index, int key, long offset, long endOffset);
+int firstIndexedRow(RowIndex* index, int key);
+int nextIndexedRow(const RowIndex* index, int entry);
+long indexedRowOffset(const RowIndex* index, int entry);
+int readRowAt(FILE* fp, long offset, char* line, int size);
+
+#endif //ROWINDEX_H
@@ -0,0 +1,28 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#define SKIPLIST_MAX_LEVEL 16
+
+// Skip list of (key, value) int pairs kept in key order, then value order,
+// so equal keys are allowed and each pair can be removed exactly.
+// A zero-initialized IntSkipList is a valid empty list.
+typedef struct IntSkipListNode {
+    int key;
+    int value;
+    int level;
+    struct IntSkipListNode* next[];
+} IntSkipListNode;
+
+typedef struct {
+    IntSkipListNode* head[SKIPLIST_MAX_LEVEL];
+    int level;
+    int count;
+    unsigned int seed;
+} IntSkipList;
+
+void clearIntSkipList(IntSkipList* list);
+void intSkipListInsert(IntSkipList* list, int key, int value);
+int intSkipListRemove(IntSkipList* list, int key, int value);
+const IntSkipListNode* intSkipListFirst(const IntSkipList* list);
+
+#endif //SKIPLIST_H
@@ -0,0 +1,44 @@
+#ifndef STOCK_LEDGER_H
+#define STOCK_LEDGER_H
+
+#include <stdio.h>
+#include <time.h>
+
+// Every change to the units on hand is appended to the ledger and never
+// rewritten, so it holds the full movement history in time order. A
+// snapshot row marks the point at which medicine.csv was last rewritten
+// with the quantities up to there.
+typedef enum {
+    STOCK_RECEIPT = 'R',
+    STOCK_DISPENSE = 'D',
+    STOCK_ADJUSTMENT = 'A',
+    STOCK_EXPIRY = 'E',
+    STOCK_SNAPSHOT = 'S'
+} StockMovementType;
+
+typedef struct {
+    time_t timestamp;
+    StockMovementType type;
+    int medicineId;
+    int quantity;           // Signed change in units on hand
+} StockMovement;
+
+typedef struct {
+    int received;
+    int dispensed;
+    int adjusted;           // Net units added by adjustments, may be negative
+    int expired;
+    int movementCount;
+} StockMovementTotals;
+
+FILE* openStockLedger();
+void closeStockLedger(FILE* ledger);
+int readStockMovement(FILE* ledger, StockMovement* movement);
+long appendStockMovement(FILE* ledger, StockMovementType type, int medicineId, int quantity);
+long appendStockMovements(FILE* ledger, StockMovementType type, const int* medicineIds,
+                          const int* quantities, int count);
+int scanStockMovements(time_t from, time_t to, void (*visit)(const StockMovement*, void*), void* context);
+int getStockMovementTotals(int medicineId, time_t from, time_t to, StockMovementTotals* totals);
+const char* getStockMovementTypeString(StockMovementType type);
+
+#endif //STOCK_LEDGER_H
@@ -0,0 +1,46 @@
+#ifndef TEXT_INDEX_H
+#define TEXT_INDEX_H
+
+#define TEXT_INDEX_MAX_QUERY 64
+
+// Case-folded trie over every suffix of the indexed strings, so a walk from
+// the root finds prefix and substring matches alike, and a walk carrying an
+// edit-distance row finds them with typos. Each string is tagged with the
+// caller's id and a field number; a lower field ranks first.
+// A zero-initialized TextIndex is a valid empty index.
+typedef struct {
+    int firstChild;
+    int nextSibling;
+    int firstPosting;       // Suffixes that end at this node
+    char label;
+} TextIndexNode;
+
+typedef struct {
+    int id;
+    int next;
+    unsigned char field;
+    unsigned char position; // Where the suffix starts in its string
+    unsigned char isWordStart;
+} TextIndexPosting;
+
+typedef struct {
+    TextIndexNode* nodes;
+    int nodeCount;
+    int nodeCapacity;
+    TextIndexPosting* postings;
+    int postingCount;
+    int postingCapacity;
+} TextIndex;
+
+typedef struct {
+    int id;
+    int edits;              // Typos corrected to match
+    int field;
+    int matchKind;          // 0 = prefix, 1 = start of a word, 2 = inside a word
+} TextMatch;
+
+void clearTextIndex(TextIndex* index);
+void addTextIndexEntry(TextIndex* index, const char* text, int id, int field);
+int searchTextIndex(const TextIndex* index, const char* query, int maxEdits, TextMatch* matches, int maxMatches);
+
+#endif //TEXT_INDEX_H
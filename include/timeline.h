@@ -0,0 +1,24 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+typedef enum {
+    TIMELINE_APPOINTMENT = 0,
+    TIMELINE_PRESCRIPTION = 1,
+    TIMELINE_EMERGENCY = 2
+} TimelineEventType;
+
+#define TIMELINE_SOURCE_COUNT 3
+
+typedef struct {
+    TimelineEventType type;
+    int date;               // Packed YYYYMMDD, 0 if unknown
+    int time;               // HHMMSS, 0 if unknown
+    long offset;            // Row offset in the source file
+} TimelineEvent;
+
+// Called once per event in chronological order with the raw CSV row
+typedef void (*TimelineWriter)(const TimelineEvent* event, const char* row, void* context);
+
+int streamPatientTimeline(int patientId, TimelineWriter writer, void* context);
+
+#endif //TIMELINE_H
@@ -13,6 +13,13 @@
 static int maxAppointmentId = 2000;
 static int isMaxAppointmentIdInitialized = 0;
 
+// patientId (column 1) -> appointment rows
+static RowIndex appointmentPatientIndex = { .path = APPOINTMENT_DATAFILE, .keyColumn = 1 };
+
+RowIndex* getAppointmentPatientIndex() {
+    return &appointmentPatientIndex;
+}
+
 // Helper function to strip newlines
 void stripAppointmentNewline(char* str) {
     size_t len = strlen(str);
@@ -230,6 +237,8 @@ void makeAppointmentEntry(Appointment* appointment) {
     stripAppointmentNewline(appointment->purpose);
     stripAppointmentNewline(appointment->status);
 
+    fseek(fp, 0, SEEK_END);
+    const long rowOffset = ftell(fp);
     fprintf(fp, "%d,%d,%s,%s,%s,%s,%s\n",
             appointment->appointmentId,
             appointment->patientId,
@@ -238,6 +247,7 @@ void makeAppointmentEntry(Appointment* appointment) {
             appointment->time,
             appointment->purpose,
             appointment->status);
+    noteRowAppended(&appointmentPatientIndex, appointment->patientId, rowOffset, ftell(fp));
 
     fclose(fp);
     printf("Appointment scheduled successfully with ID: %d\n", appointment->appointmentId);
@@ -348,6 +358,7 @@ void markAppointmentAsComplete(const int appointmentId) {
     if (found) {
         remove(APPOINTMENT_DATAFILE);
         rename("data/temp_appointment.csv", APPOINTMENT_DATAFILE);
+        invalidateRowIndex(&appointmentPatientIndex);
         printf("Appointment ID %d marked as complete.\n", appointmentId);
     } else {
         remove("data/temp_appointment.csv");
@@ -427,6 +438,7 @@ void editAppointment(const int appointmentId, Appointment* appointment) {
     if (found) {
         remove(APPOINTMENT_DATAFILE);
         rename("data/temp_appointment.csv", APPOINTMENT_DATAFILE);
+        invalidateRowIndex(&appointmentPatientIndex);
         printf("Appointment updated successfully.\n");
     } else {
         remove("data/temp_appointment.csv");
@@ -476,6 +488,7 @@ void deleteAppointment(const int appointmentId) {
     if (found) {
         remove(APPOINTMENT_DATAFILE);
         rename("data/temp_appointment.csv", APPOINTMENT_DATAFILE);
+        invalidateRowIndex(&appointmentPatientIndex);
         printf("Appointment deleted successfully.\n");
     } else {
         remove("data/temp_appointment.csv");
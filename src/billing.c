@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "billing.h"
+#include "dateutil.h"
+#include "report.h"
+#include "medicine.h"
+#include "emergency_medicines.h"
+#include "emergency_records.h"
+
+#define EMERGENCY_MEDICINES_FILE "data/emergency_medicines.csv"
+#define EMERGENCY_DATAFILE "data/emergency.csv"
+#define APPOINTMENT_DATAFILE "data/appointment.csv"
+#define PRESCRIPTION_DATAFILE "data/prescription.csv"
+#define BILL_DATAFILE "data/bills.csv"
+
+#define BATCH_BILL_BUFFER_SIZE (1 << 20)
+
+static void loadBillingPrices(BillingEngine* engine) {
+    int count;
+    const Medicine* catalog = getMedicineCatalog(&count);
+    if (count == 0) return;
+
+    engine->prices = malloc(sizeof(BillingPrice) * count);
+    for (int i = 0; i < count; i++) {
+        // Keep the first row for an ID, matching findMedicine
+        if (intMapGet(&engine->priceIndex, catalog[i].medicineId, NULL)) continue;
+
+        BillingPrice* price = &engine->prices[engine->priceCount];
+        price->medicineId = catalog[i].medicineId;
+        strcpy(price->name, catalog[i].name);
+        price->price = catalog[i].price;
+        intMapPut(&engine->priceIndex, price->medicineId, engine->priceCount);
+        engine->priceCount++;
+    }
+}
+
+static void loadBillingMedicineLines(BillingEngine* engine) {
+    refreshEmergencyMedicineIndex();
+    FILE *fp = fopen(EMERGENCY_MEDICINES_FILE, "r");
+    if (!fp) return;
+
+    int capacity = 64;
+    engine->lines = malloc(sizeof(BillingMedicineLine) * capacity);
+
+    char line[512];
+    long rowOffset = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        const long nextRowOffset = ftell(fp);
+        BillingMedicineLine medLine;
+        // Format: EmergID,MedID,MedName,Qty,Dosage,Instructions
+        if (sscanf(line, "%d,%d,%*[^,],%d", &medLine.emergencyId, &medLine.medicineId, &medLine.quantity) != 3) {
+            rowOffset = nextRowOffset;
+            continue;
+        }
+
+        // Each save appends the visit's full list again; only bill the latest block
+        long blockOffset, blockLength;
+        if (!getEmergencyMedicineBlock(medLine.emergencyId, &blockOffset, &blockLength) ||
+            rowOffset < blockOffset || rowOffset >= blockOffset + blockLength) {
+            rowOffset = nextRowOffset;
+            continue;
+        }
+        rowOffset = nextRowOffset;
+        medLine.next = -1;
+
+        if (engine->lineCount == capacity) {
+            capacity *= 2;
+            engine->lines = realloc(engine->lines, sizeof(BillingMedicineLine) * capacity);
+        }
+
+        const int index = engine->lineCount++;
+        engine->lines[index] = medLine;
+
+        // Append to the visit's chain so lines keep their file order
+        int tail;
+        if (intMapGet(&engine->lineTails, medLine.emergencyId, &tail)) {
+            engine->lines[tail].next = index;
+        } else {
+            intMapPut(&engine->lineHeads, medLine.emergencyId, index);
+        }
+        intMapPut(&engine->lineTails, medLine.emergencyId, index);
+    }
+    fclose(fp);
+}
+
+void loadBillingEngine(BillingEngine* engine) {
+    memset(engine, 0, sizeof(*engine));
+    loadBillingPrices(engine);
+    loadBillingMedicineLines(engine);
+}
+
+void loadBillingPriceTable(BillingEngine* engine) {
+    memset(engine, 0, sizeof(*engine));
+    loadBillingPrices(engine);
+}
+
+void freeBillingEngine(BillingEngine* engine) {
+    free(engine->prices);
+    free(engine->lines);
+    freeIntMap(&engine->priceIndex);
+    freeIntMap(&engine->lineHeads);
+    freeIntMap(&engine->lineTails);
+    memset(engine, 0, sizeof(*engine));
+}
+
+const BillingPrice* findBillingPrice(const BillingEngine* engine, const int medicineId) {
+    int index;
+    if (!intMapGet(&engine->priceIndex, medicineId, &index)) return NULL;
+    return &engine->prices[index];
+}
+
+int firstEmergencyMedicineLine(const BillingEngine* engine, const int emergencyId) {
+    int index;
+    if (!intMapGet(&engine->lineHeads, emergencyId, &index)) return -1;
+    return index;
+}
+
+typedef struct {
+    int patientId;
+    Money appointmentFees;
+    Money emergencyFees;
+    Money medicineTotal;
+} BillingAccumulator;
+
+// Charges of one kind as parallel columns: the patient group each belongs
+// to and its amount, totalled per group in a single pass at the end
+typedef struct {
+    int* groups;
+    Money* amounts;
+    int count;
+    int capacity;
+} ChargeColumn;
+
+typedef struct {
+    int* patientIds;        // By group
+    int count;
+    int capacity;
+    IntMap index;           // patientId -> group
+    ChargeColumn appointmentFees;
+    ChargeColumn emergencyFees;
+    ChargeColumn medicineCharges;
+} BillingAccumulators;
+
+static int getPatientGroup(BillingAccumulators* accumulators, const int patientId) {
+    int group;
+    if (intMapGet(&accumulators->index, patientId, &group)) return group;
+
+    if (accumulators->count == accumulators->capacity) {
+        accumulators->capacity = accumulators->capacity ? accumulators->capacity * 2 : 256;
+        accumulators->patientIds = realloc(accumulators->patientIds, sizeof(int) * accumulators->capacity);
+    }
+    accumulators->patientIds[accumulators->count] = patientId;
+    intMapPut(&accumulators->index, patientId, accumulators->count);
+    return accumulators->count++;
+}
+
+static void addCharge(ChargeColumn* column, const int group, const Money amount) {
+    if (column->count == column->capacity) {
+        column->capacity = column->capacity ? column->capacity * 2 : 1024;
+        column->groups = realloc(column->groups, sizeof(int) * column->capacity);
+        column->amounts = realloc(column->amounts, sizeof(Money) * column->capacity);
+    }
+    column->groups[column->count] = group;
+    column->amounts[column->count] = amount;
+    column->count++;
+}
+
+static void freeChargeColumn(ChargeColumn* column) {
+    free(column->groups);
+    free(column->amounts);
+}
+
+static void freeBillingAccumulators(BillingAccumulators* accumulators) {
+    free(accumulators->patientIds);
+    freeIntMap(&accumulators->index);
+    freeChargeColumn(&accumulators->appointmentFees);
+    freeChargeColumn(&accumulators->emergencyFees);
+    freeChargeColumn(&accumulators->medicineCharges);
+}
+
+// Per-patient totals of every charge column, in group order
+static BillingAccumulator* totalBillingAccumulators(const BillingAccumulators* accumulators) {
+    const int count = accumulators->count;
+    Money* totals = calloc((size_t)count * 3 + 1, sizeof(Money));
+    Money* appointmentTotals = totals;
+    Money* emergencyTotals = totals + count;
+    Money* medicineTotals = totals + 2 * count;
+    sumMoneyByGroup(accumulators->appointmentFees.groups, accumulators->appointmentFees.amounts,
+                    accumulators->appointmentFees.count, appointmentTotals);
+    sumMoneyByGroup(accumulators->emergencyFees.groups, accumulators->emergencyFees.amounts,
+                    accumulators->emergencyFees.count, emergencyTotals);
+    sumMoneyByGroup(accumulators->medicineCharges.groups, accumulators->medicineCharges.amounts,
+                    accumulators->medicineCharges.count, medicineTotals);
+
+    BillingAccumulator* items = malloc(sizeof(BillingAccumulator) * (count > 0 ? count : 1));
+    for (int group = 0; group < count; group++) {
+        items[group].patientId = accumulators->patientIds[group];
+        items[group].appointmentFees = appointmentTotals[group];
+        items[group].emergencyFees = emergencyTotals[group];
+        items[group].medicineTotal = medicineTotals[group];
+    }
+    free(totals);
+    return items;
+}
+
+static int isDateInRange(const char* date, const int fromDate, const int toDate) {
+    const int packed = packDate(date);
+    return packed != 0 && packed >= fromDate && packed <= toDate;
+}
+
+static void accumulateAppointments(BillingAccumulators* accumulators, const int fromDate, const int toDate) {
+    FILE *fp = fopen(APPOINTMENT_DATAFILE, "r");
+    if (!fp) return;
+
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        int patientId;
+        char date[20];
+        if (sscanf(line, "%*d,%d,%*[^,],%19[^,]", &patientId, date) == 2 &&
+            isDateInRange(date, fromDate, toDate)) {
+            addCharge(&accumulators->appointmentFees, getPatientGroup(accumulators, patientId), APPOINTMENT_FEE);
+        }
+    }
+    fclose(fp);
+}
+
+static void accumulatePrescriptions(BillingAccumulators* accumulators, const int fromDate, const int toDate) {
+    FILE *fp = fopen(PRESCRIPTION_DATAFILE, "r");
+    if (!fp) return;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), fp)) {
+        int patientId;
+        char totalText[MONEY_TEXT_SIZE];
+        char date[20];
+        Money totalPrice;
+        if (sscanf(line, "%*d,%d,%*d,%*[^,],%*d,%*[^,],%23[^,],%19[^,]", &patientId, totalText, date) == 3 &&
+            isDateInRange(date, fromDate, toDate) && parseMoney(totalText, &totalPrice)) {
+            addCharge(&accumulators->medicineCharges, getPatientGroup(accumulators, patientId), totalPrice);
+        }
+    }
+    fclose(fp);
+}
+
+static void accumulateEmergencies(BillingAccumulators* accumulators, const BillingEngine* engine,
+                                  const int fromDate, const int toDate) {
+    refreshEmergencyRecordIndex();
+    FILE *fp = fopen(EMERGENCY_DATAFILE, "r");
+    if (!fp) return;
+
+    char line[1024];
+    long rowOffset = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        const long rowStart = rowOffset;
+        rowOffset = ftell(fp);
+
+        int emergencyId, patientId;
+        char arrivalDate[20];
+        if (sscanf(line, "%d,%d,%*[^,],%*[^,],%*[^,],%*[^,],%19[^,]", &emergencyId, &patientId, arrivalDate) != 3 ||
+            !isCurrentEmergencyRecord(emergencyId, rowStart) || !isDateInRange(arrivalDate, fromDate, toDate)) {
+            continue;
+        }
+
+        const int group = getPatientGroup(accumulators, patientId);
+        addCharge(&accumulators->emergencyFees, group, EMERGENCY_BASE_FEE);
+
+        for (int i = firstEmergencyMedicineLine(engine, emergencyId); i >= 0; i = engine->lines[i].next) {
+            const BillingPrice* price = findBillingPrice(engine, engine->lines[i].medicineId);
+            if (price) {
+                addCharge(&accumulators->medicineCharges, group, price->price * engine->lines[i].quantity);
+            }
+        }
+    }
+    fclose(fp);
+}
+
+static int compareAccumulatorsByPatient(const void* a, const void* b) {
+    const int left = ((const BillingAccumulator*)a)->patientId;
+    const int right = ((const BillingAccumulator*)b)->patientId;
+    return (left > right) - (left < right);
+}
+
+// Bill every patient with activity between fromDate and toDate (packed YYYYMMDD, inclusive).
+// Returns the number of bills written, or -1 if the bill file could not be opened.
+int generateBatchBills(const int fromDate, const int toDate) {
+    BillingEngine engine;
+    loadBillingEngine(&engine);
+
+    BillingAccumulators accumulators = {0};
+    accumulateAppointments(&accumulators, fromDate, toDate);
+    accumulatePrescriptions(&accumulators, fromDate, toDate);
+    accumulateEmergencies(&accumulators, &engine, fromDate, toDate);
+    freeBillingEngine(&engine);
+
+    FILE *fp = fopen(BILL_DATAFILE, "a");
+    if (!fp) {
+        freeBillingAccumulators(&accumulators);
+        return -1;
+    }
+    // One large buffer so the whole run goes out in a handful of writes
+    setvbuf(fp, NULL, _IOFBF, BATCH_BILL_BUFFER_SIZE);
+
+    const int billCount = accumulators.count;
+    BillingAccumulator* items = totalBillingAccumulators(&accumulators);
+    freeBillingAccumulators(&accumulators);
+    qsort(items, billCount, sizeof(BillingAccumulator), compareAccumulatorsByPatient);
+
+    char fromStr[12], toStr[12];
+    unpackDate(fromDate, fromStr, sizeof(fromStr));
+    unpackDate(toDate, toStr, sizeof(toStr));
+
+    Bill bill = {0};
+    unpackDate(getTodayPackedDate(), bill.billDate, sizeof(bill.billDate));
+    strcpy(bill.paymentStatus, "Unpaid");
+    snprintf(bill.notes, sizeof(bill.notes), "Batch %s-%s", fromStr, toStr);
+
+    for (int i = 0; i < billCount; i++) {
+        const BillingAccumulator* accumulator = &items[i];
+        bill.billId = generateBillId();
+        bill.patientId = accumulator->patientId;
+        bill.consultationFee = accumulator->appointmentFees;
+        bill.emergencyFee = accumulator->emergencyFees;
+        bill.medicineTotal = accumulator->medicineTotal;
+        bill.grandTotal = accumulator->appointmentFees + accumulator->emergencyFees + accumulator->medicineTotal;
+        writeBillRecord(fp, &bill);
+    }
+    fclose(fp);
+
+    free(items);
+    return billCount;
+}
+
+void runBatchBilling() {
+    char fromStr[20], toStr[20];
+
+    printf("\n==== Batch Billing ====\n");
+    printf("From date (DD/MM/YYYY): ");
+    fgets(fromStr, sizeof(fromStr), stdin);
+    fromStr[strcspn(fromStr, "\n")] = 0;
+    printf("To date (DD/MM/YYYY): ");
+    fgets(toStr, sizeof(toStr), stdin);
+    toStr[strcspn(toStr, "\n")] = 0;
+
+    const int fromDate = packDate(fromStr);
+    const int toDate = packDate(toStr);
+    if (fromDate == 0 || toDate == 0 || fromDate > toDate) {
+        printf("Invalid date range.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+
+    const clock_t start = clock();
+    const int billCount = generateBatchBills(fromDate, toDate);
+    const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (billCount < 0) {
+        printf("Error opening bill data file.\n");
+    } else {
+        printf("Generated %d bills in %.2f seconds.\n", billCount, seconds);
+    }
+    printf("Press Enter to return to menu...");
+    getchar();
+}
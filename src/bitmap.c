@@ -0,0 +1,74 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap.h"
+
+#define BITS_PER_WORD 64
+
+static void growRowBitmap(RowBitmap* bitmap, const int wordCount) {
+    if (wordCount <= bitmap->wordCount) return;
+
+    int newCount = bitmap->wordCount ? bitmap->wordCount : 4;
+    while (newCount < wordCount) newCount *= 2;
+    bitmap->words = realloc(bitmap->words, sizeof(unsigned long long) * newCount);
+    memset(bitmap->words + bitmap->wordCount, 0, sizeof(unsigned long long) * (newCount - bitmap->wordCount));
+    bitmap->wordCount = newCount;
+}
+
+void clearRowBitmap(RowBitmap* bitmap) {
+    if (bitmap->wordCount > 0) memset(bitmap->words, 0, sizeof(unsigned long long) * bitmap->wordCount);
+}
+
+void setRowBit(RowBitmap* bitmap, const int row) {
+    growRowBitmap(bitmap, row / BITS_PER_WORD + 1);
+    bitmap->words[row / BITS_PER_WORD] |= 1ULL << (row % BITS_PER_WORD);
+}
+
+void copyRowBitmap(RowBitmap* into, const RowBitmap* from) {
+    growRowBitmap(into, from->wordCount);
+    clearRowBitmap(into);
+    if (from->wordCount > 0) memcpy(into->words, from->words, sizeof(unsigned long long) * from->wordCount);
+}
+
+// Keep only the rows that are also in `with`
+void intersectRowBitmaps(RowBitmap* into, const RowBitmap* with) {
+    const int common = into->wordCount < with->wordCount ? into->wordCount : with->wordCount;
+    for (int i = 0; i < common; i++) {
+        into->words[i] &= with->words[i];
+    }
+    for (int i = common; i < into->wordCount; i++) {
+        into->words[i] = 0;
+    }
+}
+
+int countRowBits(const RowBitmap* bitmap) {
+    int count = 0;
+    for (int i = 0; i < bitmap->wordCount; i++) {
+        // Parallel bit count, no compiler builtins needed
+        unsigned long long x = bitmap->words[i];
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        count += (int)((x * 0x0101010101010101ULL) >> 56);
+    }
+    return count;
+}
+
+// The first row at or after `from` in the set, or -1 if there is none
+int nextSetRow(const RowBitmap* bitmap, const int from) {
+    if (from < 0) return -1;
+    int i = from / BITS_PER_WORD;
+    if (i >= bitmap->wordCount) return -1;
+
+    unsigned long long word = bitmap->words[i] & (~0ULL << (from % BITS_PER_WORD));
+    while (word == 0) {
+        if (++i >= bitmap->wordCount) return -1;
+        word = bitmap->words[i];
+    }
+
+    int bit = 0;
+    while (!(word & 1ULL)) {
+        word >>= 1;
+        bit++;
+    }
+    return i * BITS_PER_WORD + bit;
+}
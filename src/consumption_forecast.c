@@ -0,0 +1,404 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "consumption_forecast.h"
+#include "prescription.h"
+#include "emergency_medicines.h"
+#include "emergency_records.h"
+#include "dateutil.h"
+#include "hashmap.h"
+
+#define PRESCRIPTION_DATAFILE "data/prescription.csv"
+#define EMERGENCY_MEDICINE_DATAFILE "data/emergency_medicines.csv"
+#define FORECAST_DATAFILE "data/medicine_forecast.csv"
+#define FORECAST_TEMP_FILE "data/medicine_forecast_temp.csv"
+
+#define DAILY_SMOOTHING 0.2         // Weight of the newest day in the average
+#define WEEKDAY_SMOOTHING 0.1       // Weight of the newest week in each weekday
+#define MIN_SEASONAL_DAYS 28        // History needed before weekdays are trusted
+#define MIN_WEEKDAY_FACTOR 0.1     // Quieter weekdays say little about the level
+#define MAX_GAP_DAYS 366
+
+static MedicineConsumption* consumption = NULL;
+static int consumptionCount = 0;
+static int consumptionCapacity = 0;
+static IntMap consumptionIndex;     // medicineId -> slot in consumption
+
+// Emergency saves repeat a visit's whole medicine list, so only the rows
+// past those already counted are new dispenses
+static int* visitIds = NULL;
+static int* visitCountedRows = NULL;
+static int visitCount = 0;
+static int visitCapacity = 0;
+static IntMap visitIndex;           // emergencyId -> slot in visitIds
+
+static long prescriptionOffset = 0;
+static long emergencyOffset = 0;
+static int isForecastLoaded = 0;
+
+static void resetForecastState() {
+    consumptionCount = 0;
+    clearIntMap(&consumptionIndex);
+    visitCount = 0;
+    clearIntMap(&visitIndex);
+    prescriptionOffset = 0;
+    emergencyOffset = 0;
+}
+
+static MedicineConsumption* getConsumption(const int medicineId) {
+    int slot;
+    return intMapGet(&consumptionIndex, medicineId, &slot) ? &consumption[slot] : NULL;
+}
+
+static MedicineConsumption* getOrAddConsumption(const int medicineId) {
+    MedicineConsumption* existing = getConsumption(medicineId);
+    if (existing) return existing;
+
+    if (consumptionCount == consumptionCapacity) {
+        consumptionCapacity = consumptionCapacity ? consumptionCapacity * 2 : 64;
+        consumption = realloc(consumption, sizeof(MedicineConsumption) * consumptionCapacity);
+    }
+    MedicineConsumption* added = &consumption[consumptionCount];
+    memset(added, 0, sizeof(*added));
+    added->medicineId = medicineId;
+    intMapPut(&consumptionIndex, medicineId, consumptionCount++);
+    return added;
+}
+
+static int* getVisitCountedRows(const int emergencyId) {
+    int slot;
+    if (intMapGet(&visitIndex, emergencyId, &slot)) return &visitCountedRows[slot];
+
+    if (visitCount == visitCapacity) {
+        visitCapacity = visitCapacity ? visitCapacity * 2 : 256;
+        visitIds = realloc(visitIds, sizeof(int) * visitCapacity);
+        visitCountedRows = realloc(visitCountedRows, sizeof(int) * visitCapacity);
+    }
+    visitIds[visitCount] = emergencyId;
+    visitCountedRows[visitCount] = 0;
+    intMapPut(&visitIndex, emergencyId, visitCount);
+    return &visitCountedRows[visitCount++];
+}
+
+// Each weekday's demand relative to an average day, all 1 until there is
+// enough history to tell the days apart
+static void getWeekdayFactors(const MedicineConsumption* entry, double factors[7]) {
+    double rates[7], total = 0.0;
+    int weekdays = 0;
+    for (int day = 0; day < 7; day++) {
+        factors[day] = 1.0;
+        rates[day] = entry->weekdayWeight[day] > 0 ? entry->weekdayUnits[day] / entry->weekdayWeight[day] : -1.0;
+        if (rates[day] >= 0) {
+            total += rates[day];
+            weekdays++;
+        }
+    }
+    if (entry->closedDays < MIN_SEASONAL_DAYS || weekdays < 7 || total <= 0) return;
+
+    const double mean = total / 7;
+    for (int day = 0; day < 7; day++) {
+        factors[day] = rates[day] / mean;
+    }
+}
+
+// The average follows each day's units scaled to an average weekday, so a
+// busy Monday does not read as a rise in demand
+static void closeDay(MedicineConsumption* entry, const int units, const int weekday) {
+    double factors[7];
+    getWeekdayFactors(entry, factors);
+    const double adjusted = factors[weekday] > MIN_WEEKDAY_FACTOR ? units / factors[weekday]
+                                                                   : entry->averageDailyUnits;
+
+    if (entry->closedDays == 0) entry->averageDailyUnits = units;
+    else entry->averageDailyUnits += DAILY_SMOOTHING * (adjusted - entry->averageDailyUnits);
+
+    entry->weekdayUnits[weekday] = entry->weekdayUnits[weekday] * (1.0 - WEEKDAY_SMOOTHING) + units;
+    entry->weekdayWeight[weekday] = entry->weekdayWeight[weekday] * (1.0 - WEEKDAY_SMOOTHING) + 1.0;
+    entry->closedDays++;
+}
+
+// Close the open day and every day without dispenses up to `packedDate`,
+// which becomes the open day. Earlier dates leave the open day as it is.
+static void advanceToDate(MedicineConsumption* entry, const int packedDate) {
+    if (entry->currentDate == 0) {
+        entry->currentDate = packedDate;
+        return;
+    }
+    if (packedDate <= entry->currentDate) return;
+
+    const int gap = daysBetweenPackedDates(entry->currentDate, packedDate);
+    const int weekday = getPackedDateWeekday(entry->currentDate);
+    closeDay(entry, entry->currentDayUnits, weekday);
+    for (int day = 1; day < gap && day <= MAX_GAP_DAYS; day++) {
+        closeDay(entry, 0, (weekday + day) % 7);
+    }
+    entry->currentDate = packedDate;
+    entry->currentDayUnits = 0;
+}
+
+// Late rows are counted on the open day rather than reopening a closed one
+static void addConsumption(const int medicineId, const int packedDate, const int units) {
+    MedicineConsumption* entry = getOrAddConsumption(medicineId);
+    advanceToDate(entry, packedDate);
+    entry->currentDayUnits += units;
+}
+
+typedef struct {
+    int packedDate;
+    int sequence;
+    int medicineId;
+    int units;
+} Dispense;
+
+// Dispenses read in one fold, applied in date order once both files are read
+static Dispense* pending = NULL;
+static int pendingCount = 0;
+static int pendingCapacity = 0;
+
+static void addPendingDispense(const int medicineId, const int packedDate, const int units) {
+    if (medicineId <= 0 || packedDate == 0 || units <= 0) return;
+
+    if (pendingCount == pendingCapacity) {
+        pendingCapacity = pendingCapacity ? pendingCapacity * 2 : 256;
+        pending = realloc(pending, sizeof(Dispense) * pendingCapacity);
+    }
+    pending[pendingCount].packedDate = packedDate;
+    pending[pendingCount].sequence = pendingCount;
+    pending[pendingCount].medicineId = medicineId;
+    pending[pendingCount].units = units;
+    pendingCount++;
+}
+
+static int compareDispenses(const void* a, const void* b) {
+    const Dispense* x = a;
+    const Dispense* y = b;
+    if (x->packedDate != y->packedDate) return x->packedDate < y->packedDate ? -1 : 1;
+    return x->sequence - y->sequence;
+}
+
+static void applyPendingDispenses() {
+    if (pendingCount > 1) qsort(pending, pendingCount, sizeof(Dispense), compareDispenses);
+    for (int i = 0; i < pendingCount; i++) {
+        addConsumption(pending[i].medicineId, pending[i].packedDate, pending[i].units);
+    }
+    pendingCount = 0;
+}
+
+static int parseConsumptionLine(const char* line, MedicineConsumption* entry) {
+    char* end;
+    const char* field = line + strlen("medicine,");
+    memset(entry, 0, sizeof(*entry));
+
+    entry->medicineId = (int)strtol(field, &end, 10);
+    if (*end != ',') return 0;
+    entry->currentDate = (int)strtol(end + 1, &end, 10);
+    if (*end != ',') return 0;
+    entry->currentDayUnits = (int)strtol(end + 1, &end, 10);
+    if (*end != ',') return 0;
+    entry->averageDailyUnits = strtod(end + 1, &end);
+    if (*end != ',') return 0;
+    entry->closedDays = (int)strtol(end + 1, &end, 10);
+    for (int i = 0; i < 7; i++) {
+        if (*end != ',') return 0;
+        entry->weekdayUnits[i] = strtod(end + 1, &end);
+    }
+    for (int i = 0; i < 7; i++) {
+        if (*end != ',') return 0;
+        entry->weekdayWeight[i] = strtod(end + 1, &end);
+    }
+    return entry->medicineId > 0;
+}
+
+static int readForecastSnapshot() {
+    FILE *fp = fopen(FORECAST_DATAFILE, "r");
+    if (!fp) return 0;
+
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        long offset;
+        int emergencyId, rows;
+        MedicineConsumption entry;
+        if (sscanf(line, "prescriptionOffset,%ld", &offset) == 1) {
+            prescriptionOffset = offset;
+        } else if (sscanf(line, "emergencyOffset,%ld", &offset) == 1) {
+            emergencyOffset = offset;
+        } else if (sscanf(line, "visit,%d,%d", &emergencyId, &rows) == 2) {
+            *getVisitCountedRows(emergencyId) = rows;
+        } else if (strncmp(line, "medicine,", strlen("medicine,")) == 0 && parseConsumptionLine(line, &entry)) {
+            *getOrAddConsumption(entry.medicineId) = entry;
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+static void writeForecastSnapshot() {
+    FILE *fp = fopen(FORECAST_TEMP_FILE, "w");
+    if (!fp) {
+        perror("Unable to save consumption forecast");
+        return;
+    }
+
+    fprintf(fp, "prescriptionOffset,%ld\n", prescriptionOffset);
+    fprintf(fp, "emergencyOffset,%ld\n", emergencyOffset);
+    for (int i = 0; i < visitCount; i++) {
+        fprintf(fp, "visit,%d,%d\n", visitIds[i], visitCountedRows[i]);
+    }
+    for (int i = 0; i < consumptionCount; i++) {
+        const MedicineConsumption* entry = &consumption[i];
+        fprintf(fp, "medicine,%d,%d,%d,%.6f,%d", entry->medicineId, entry->currentDate,
+                entry->currentDayUnits, entry->averageDailyUnits, entry->closedDays);
+        for (int day = 0; day < 7; day++) fprintf(fp, ",%.6f", entry->weekdayUnits[day]);
+        for (int day = 0; day < 7; day++) fprintf(fp, ",%.6f", entry->weekdayWeight[day]);
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+
+    remove(FORECAST_DATAFILE);
+    rename(FORECAST_TEMP_FILE, FORECAST_DATAFILE);
+}
+
+static long getFileSize(const char* path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+static void foldPrescriptions() {
+    FILE *fp = fopen(PRESCRIPTION_DATAFILE, "r");
+    if (!fp) return;
+    fseek(fp, prescriptionOffset, SEEK_SET);
+
+    char line[1024];
+    Prescription prescription;
+    while (fgets(line, sizeof(line), fp)) {
+        // Leave a row another terminal is still writing for next time
+        if (!strchr(line, '\n')) break;
+        if (parsePrescriptionLine(line, &prescription)) {
+            addPendingDispense(prescription.medicineId, packDate(prescription.prescribedDate), prescription.quantity);
+        }
+        prescriptionOffset = ftell(fp);
+    }
+    fclose(fp);
+}
+
+static void foldEmergencyMedicines() {
+    FILE *fp = fopen(EMERGENCY_MEDICINE_DATAFILE, "r");
+    if (!fp) return;
+    fseek(fp, emergencyOffset, SEEK_SET);
+
+    // Visits saved since the last fold, each once
+    IntMap seen = {0};
+    int* touched = NULL;
+    int touchedCount = 0, touchedCapacity = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strchr(line, '\n')) break;
+        int emergencyId, slot;
+        if (sscanf(line, "%d,", &emergencyId) == 1 && !intMapGet(&seen, emergencyId, &slot)) {
+            if (touchedCount == touchedCapacity) {
+                touchedCapacity = touchedCapacity ? touchedCapacity * 2 : 64;
+                touched = realloc(touched, sizeof(int) * touchedCapacity);
+            }
+            intMapPut(&seen, emergencyId, touchedCount);
+            touched[touchedCount++] = emergencyId;
+        }
+        emergencyOffset = ftell(fp);
+    }
+    fclose(fp);
+    freeIntMap(&seen);
+    if (touchedCount == 0) return;
+
+    refreshEmergencyMedicineIndex();
+    EmergencyMedicine medicines[MAX_EMERGENCY_MEDICINES];
+    EmergencyPatient record;
+    for (int i = 0; i < touchedCount; i++) {
+        const int count = findEmergencyMedicines(touched[i], medicines, MAX_EMERGENCY_MEDICINES);
+        int* countedRows = getVisitCountedRows(touched[i]);
+        if (count <= *countedRows) continue;
+
+        const int packedDate = findEmergencyRecord(touched[i], &record) ? packDate(record.arrivalDate)
+                                                                        : getTodayPackedDate();
+        for (int row = *countedRows; row < count; row++) {
+            addPendingDispense(medicines[row].medicineId, packedDate, medicines[row].quantity);
+        }
+        *countedRows = count;
+    }
+    free(touched);
+}
+
+// Fold whatever prescription.csv and emergency_medicines.csv gained since
+// the last snapshot, so each dispense is read about once. A file smaller
+// than its folded offset was rewritten and the history is rebuilt.
+void refreshConsumptionForecast() {
+    int isSnapshotCurrent = 1;
+    if (!isForecastLoaded) {
+        isSnapshotCurrent = readForecastSnapshot();
+        isForecastLoaded = 1;
+    } else if (!getFileSize(FORECAST_DATAFILE)) {
+        // Another terminal reset the forecast after rewriting history
+        resetForecastState();
+        isSnapshotCurrent = 0;
+    }
+
+    if (getFileSize(PRESCRIPTION_DATAFILE) < prescriptionOffset ||
+        getFileSize(EMERGENCY_MEDICINE_DATAFILE) < emergencyOffset) {
+        resetForecastState();
+        isSnapshotCurrent = 0;
+    }
+
+    const long startPrescriptionOffset = prescriptionOffset;
+    const long startEmergencyOffset = emergencyOffset;
+    foldPrescriptions();
+    foldEmergencyMedicines();
+    applyPendingDispenses();
+
+    if (!isSnapshotCurrent || prescriptionOffset != startPrescriptionOffset ||
+        emergencyOffset != startEmergencyOffset) {
+        writeForecastSnapshot();
+    }
+}
+
+// For callers that rewrite prescriptions in place, which can change past
+// quantities without shrinking the file
+void resetConsumptionForecast() {
+    resetForecastState();
+    remove(FORECAST_DATAFILE);
+}
+
+// The entry as of the start of today, with every earlier day closed
+static int getConsumptionAsOfToday(const int medicineId, MedicineConsumption* entry) {
+    const MedicineConsumption* stored = getConsumption(medicineId);
+    if (!stored) return 0;
+
+    *entry = *stored;
+    advanceToDate(entry, getTodayPackedDate());
+    return 1;
+}
+
+// Whole days `quantity` units last at the forecast demand, as of the last
+// refresh. Returns -1 without any consumption to go on, and
+// FORECAST_HORIZON_DAYS + 1 if the stock outlasts the horizon.
+int getDaysOfStockRemaining(const int medicineId, const int quantity) {
+    MedicineConsumption entry;
+    if (!getConsumptionAsOfToday(medicineId, &entry) || entry.closedDays == 0 ||
+        entry.averageDailyUnits <= 0.0) {
+        return -1;
+    }
+    if (quantity <= 0) return 0;
+
+    double factors[7];
+    getWeekdayFactors(&entry, factors);
+    const int today = getPackedDateWeekday(getTodayPackedDate());
+
+    double remaining = quantity;
+    for (int day = 0; day < FORECAST_HORIZON_DAYS; day++) {
+        const double demand = entry.averageDailyUnits * factors[(today + day) % 7];
+        if (remaining < demand) return day;
+        remaining -= demand;
+    }
+    return FORECAST_HORIZON_DAYS + 1;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <time.h>
+#include "dateutil.h"
+
+// Convert "DD/MM/YYYY" into YYYYMMDD, or 0 if the string is not a valid date
+int packDate(const char* date) {
+    int day, month, year;
+    if (!date || sscanf(date, "%d/%d/%d", &day, &month, &year) != 3) return 0;
+    if (day < 1 || day > 31 || month < 1 || month > 12 || year < 1900) return 0;
+    return year * 10000 + month * 100 + day;
+}
+
+void unpackDate(const int packedDate, char* date, const size_t size) {
+    snprintf(date, size, "%02d/%02d/%04d",
+             packedDate % 100, (packedDate / 100) % 100, packedDate / 10000);
+}
+
+int getTodayPackedDate() {
+    time_t now;
+    time(&now);
+    const struct tm* tm_info = localtime(&now);
+    return (tm_info->tm_year + 1900) * 10000 + (tm_info->tm_mon + 1) * 100 + tm_info->tm_mday;
+}
+
+// Local timestamp for "DD/MM/YYYY" and "HH:MM" or "HH:MM:SS", or -1 if either does not parse
+time_t parseDateTime(const char* date, const char* time) {
+    struct tm moment = {0};
+    int second = 0;
+    const int packed = packDate(date);
+    if (packed == 0 || !time || sscanf(time, "%d:%d:%d", &moment.tm_hour, &moment.tm_min, &second) < 2) {
+        return (time_t)-1;
+    }
+
+    moment.tm_mday = packed % 100;
+    moment.tm_mon = (packed / 100) % 100 - 1;
+    moment.tm_year = packed / 10000 - 1900;
+    moment.tm_sec = second;
+    moment.tm_isdst = -1;
+    return mktime(&moment);
+}
+
+// The packed date `days` days after `packedDate` (before, if negative)
+int addDaysToPackedDate(const int packedDate, const int days) {
+    struct tm moment = {0};
+    moment.tm_mday = packedDate % 100 + days;
+    moment.tm_mon = (packedDate / 100) % 100 - 1;
+    moment.tm_year = packedDate / 10000 - 1900;
+    moment.tm_hour = 12;    // Clear of daylight saving changes
+    moment.tm_isdst = -1;
+    mktime(&moment);
+    return (moment.tm_year + 1900) * 10000 + (moment.tm_mon + 1) * 100 + moment.tm_mday;
+}
+
+static time_t packedDateToNoon(const int packedDate) {
+    struct tm moment = {0};
+    moment.tm_mday = packedDate % 100;
+    moment.tm_mon = (packedDate / 100) % 100 - 1;
+    moment.tm_year = packedDate / 10000 - 1900;
+    moment.tm_hour = 12;
+    moment.tm_isdst = -1;
+    return mktime(&moment);
+}
+
+// Whole days from `fromDate` to `toDate`, negative if toDate is earlier
+int daysBetweenPackedDates(const int fromDate, const int toDate) {
+    const double seconds = difftime(packedDateToNoon(toDate), packedDateToNoon(fromDate));
+    return (int)(seconds / (24 * 60 * 60) + (seconds < 0 ? -0.5 : 0.5));
+}
+
+// 0 = Sunday through 6 = Saturday
+int getPackedDateWeekday(const int packedDate) {
+    const time_t noon = packedDateToNoon(packedDate);
+    return localtime(&noon)->tm_wday;
+}
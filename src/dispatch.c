@@ -0,0 +1,560 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "dispatch.h"
+#include "emergency_queue.h"
+#include "emergency_records.h"
+#include "dateutil.h"
+
+#define ER_DOCTOR_DATAFILE "data/er_doctors.csv"
+#define EMERGENCY_DATAFILE "data/emergency.csv"
+
+typedef struct {
+    const char* keyword;
+    const char* specialty;
+} SpecialtyKeyword;
+
+// First matching keyword in the symptoms decides the specialty
+static const SpecialtyKeyword specialtyKeywords[] = {
+    { "chest", "Cardiology" },
+    { "heart", "Cardiology" },
+    { "palpitation", "Cardiology" },
+    { "stroke", "Neurology" },
+    { "seizure", "Neurology" },
+    { "unconscious", "Neurology" },
+    { "head", "Neurology" },
+    { "breath", "Pulmonology" },
+    { "asthma", "Pulmonology" },
+    { "cough", "Pulmonology" },
+    { "fracture", "Orthopedics" },
+    { "bone", "Orthopedics" },
+    { "sprain", "Orthopedics" },
+    { "bleed", "Trauma" },
+    { "accident", "Trauma" },
+    { "wound", "Trauma" },
+    { "burn", "Trauma" },
+    { "child", "Pediatrics" },
+    { "infant", "Pediatrics" },
+};
+
+// Simulated treatment time in minutes, indexed by priority
+static const int simulatedTreatmentMinutes[] = { 0, 90, 60, 40, 25 };
+
+static int equalsIgnoreCase(const char* a, const char* b) {
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return 0;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+const char* inferEmergencySpecialty(const char* symptoms) {
+    char symptomsLower[200];
+    strncpy(symptomsLower, symptoms, sizeof(symptomsLower) - 1);
+    symptomsLower[sizeof(symptomsLower) - 1] = '\0';
+    for (int i = 0; symptomsLower[i]; i++) {
+        symptomsLower[i] = tolower((unsigned char)symptomsLower[i]);
+    }
+
+    for (size_t i = 0; i < sizeof(specialtyKeywords) / sizeof(specialtyKeywords[0]); i++) {
+        if (strstr(symptomsLower, specialtyKeywords[i].keyword)) return specialtyKeywords[i].specialty;
+    }
+    return GENERAL_SPECIALTY;
+}
+
+int loadEmergencyRoster(EmergencyRoster* roster) {
+    memset(roster, 0, sizeof(*roster));
+
+    FILE *fp = fopen(ER_DOCTOR_DATAFILE, "r");
+    if (!fp) return 0;
+
+    int capacity = 8;
+    roster->doctors = malloc(sizeof(EmergencyDoctor) * capacity);
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        // Format: Name,Specialty;Specialty,MaxPatients
+        EmergencyDoctor doctor = {0};
+        char specialties[128];
+        if (sscanf(line, "%49[^,],%127[^,],%d", doctor.name, specialties, &doctor.maxPatients) != 3) continue;
+        if (doctor.maxPatients < 1) doctor.maxPatients = 1;
+
+        for (char* token = strtok(specialties, ";"); token && doctor.specialtyCount < MAX_DOCTOR_SPECIALTIES;
+             token = strtok(NULL, ";")) {
+            while (*token == ' ') token++;
+            strncpy(doctor.specialties[doctor.specialtyCount], token, sizeof(doctor.specialties[0]) - 1);
+            doctor.specialtyCount++;
+        }
+
+        if (roster->count == capacity) {
+            capacity *= 2;
+            roster->doctors = realloc(roster->doctors, sizeof(EmergencyDoctor) * capacity);
+        }
+        roster->doctors[roster->count++] = doctor;
+    }
+    fclose(fp);
+    return roster->count;
+}
+
+void freeEmergencyRoster(EmergencyRoster* roster) {
+    free(roster->doctors);
+    memset(roster, 0, sizeof(*roster));
+}
+
+static int hasSpecialty(const EmergencyDoctor* doctor, const char* specialty) {
+    for (int i = 0; i < doctor->specialtyCount; i++) {
+        if (equalsIgnoreCase(doctor->specialties[i], specialty)) return 1;
+    }
+    return 0;
+}
+
+// 2 = specialist for the case, 1 = generalist, 0 = other specialty
+static int getDoctorRank(const EmergencyDoctor* doctor, const char* specialty) {
+    if (hasSpecialty(doctor, specialty)) return 2;
+    if (hasSpecialty(doctor, GENERAL_SPECIALTY)) return 1;
+    return 0;
+}
+
+// Pick a doctor with spare capacity for a patient, or -1 if they should
+// keep waiting. Specialists beat generalists; a doctor from another
+// specialty only takes CRITICAL patients or cases no one on the roster
+// covers. Ties go to the least loaded doctor.
+int chooseEmergencyDoctor(const EmergencyRoster* roster, const char* specialty, const EmergencyPriority priority) {
+    int bestRankOnRoster = 0;
+    for (int i = 0; i < roster->count; i++) {
+        const int rank = getDoctorRank(&roster->doctors[i], specialty);
+        if (rank > bestRankOnRoster) bestRankOnRoster = rank;
+    }
+    const int minimumRank = (priority == CRITICAL || bestRankOnRoster == 0) ? 0 : 1;
+
+    int best = -1, bestRank = -1;
+    for (int i = 0; i < roster->count; i++) {
+        const EmergencyDoctor* doctor = &roster->doctors[i];
+        if (doctor->currentPatients >= doctor->maxPatients) continue;
+
+        const int rank = getDoctorRank(doctor, specialty);
+        if (rank < minimumRank) continue;
+
+        if (rank > bestRank ||
+            (rank == bestRank && doctor->currentPatients * roster->doctors[best].maxPatients <
+                                 roster->doctors[best].currentPatients * doctor->maxPatients)) {
+            best = i;
+            bestRank = rank;
+        }
+    }
+    return best;
+}
+
+static int findRosterDoctor(const EmergencyRoster* roster, const char* name) {
+    for (int i = 0; i < roster->count; i++) {
+        if (equalsIgnoreCase(roster->doctors[i].name, name)) return i;
+    }
+    return -1;
+}
+
+// Current load is every patient on the live board marked In Treatment
+// under the doctor's name
+static void countDoctorLoads(EmergencyRoster* roster) {
+    for (int i = 0; i < roster->count; i++) {
+        roster->doctors[i].currentPatients = 0;
+    }
+
+    int heldCount;
+    EmergencyPatient* held = copyEmergencyBoard(&heldCount);
+    for (int i = 0; i < heldCount; i++) {
+        if (strcmp(held[i].status, "In Treatment") != 0) continue;
+        const int doctor = findRosterDoctor(roster, held[i].treatingDoctor);
+        if (doctor >= 0) roster->doctors[doctor].currentPatients++;
+    }
+    free(held);
+}
+
+// Hand waiting patients, most urgent first, to doctors with spare capacity.
+// A patient whose doctors are all busy does not hold up the ones behind.
+// Returns the number of patients dispatched.
+int dispatchWaitingPatients(EmergencyRoster* roster) {
+    countDoctorLoads(roster);
+
+    int queueCount, dispatched = 0;
+    EmergencyPatient* queued = copyEmergencyQueue(&queueCount);
+
+    // Only waiting patients are queued; those in treatment stay on the board
+    for (int i = 0; i < queueCount; i++) {
+        const EmergencyPatient* candidate = &queued[i];
+        const char* specialty = inferEmergencySpecialty(candidate->symptoms);
+        const int doctor = chooseEmergencyDoctor(roster, specialty, candidate->effectivePriority);
+        if (doctor < 0) continue;
+
+        // Another terminal may have taken them since the snapshot
+        EmergencyPatient claimed;
+        if (!claimEmergencyPatient(candidate->emergencyId, roster->doctors[doctor].name, &claimed)) continue;
+
+        roster->doctors[doctor].currentPatients++;
+        saveEmergencyRecord(&claimed);
+        dispatched++;
+
+        printf("%-10d %-20s %-10s %-16s -> %s\n", claimed.emergencyId, claimed.patientName,
+               getPriorityString(claimed.effectivePriority), specialty, claimed.treatingDoctor);
+    }
+    free(queued);
+    return dispatched;
+}
+
+typedef struct {
+    int emergencyId;
+    int arrival;            // Minutes after midnight
+    EmergencyPriority priority;
+    const char* specialty;
+    int isWaiting;
+} SimulatedArrival;
+
+typedef struct {
+    int doctor;
+    int end;
+} SimulatedTreatment;
+
+static int compareSimulatedArrivals(const void* a, const void* b) {
+    const SimulatedArrival* left = a;
+    const SimulatedArrival* right = b;
+    if (left->arrival != right->arrival) return left->arrival < right->arrival ? -1 : 1;
+    return (left->emergencyId > right->emergencyId) - (left->emergencyId < right->emergencyId);
+}
+
+static EmergencyPriority ageSimulatedPriority(const EmergencyPriority priority, const int waited, const int agingMinutes) {
+    if (agingMinutes <= 0) return priority;
+    const int promoted = (int)priority - waited / agingMinutes;
+    return promoted < CRITICAL ? CRITICAL : (EmergencyPriority)promoted;
+}
+
+static SimulatedArrival* loadSimulatedArrivals(const int packedDate, int* count) {
+    *count = 0;
+    refreshEmergencyRecordIndex();
+    FILE *fp = fopen(EMERGENCY_DATAFILE, "r");
+    if (!fp) return NULL;
+
+    int capacity = 64;
+    SimulatedArrival* arrivals = malloc(sizeof(SimulatedArrival) * capacity);
+
+    char line[1024];
+    EmergencyPatient record;
+    long rowOffset = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        const long rowStart = rowOffset;
+        rowOffset = ftell(fp);
+
+        int hour, minute;
+        if (!parseEmergencyRecord(line, &record) || !isCurrentEmergencyRecord(record.emergencyId, rowStart) ||
+            packDate(record.arrivalDate) != packedDate || sscanf(record.arrivalTime, "%d:%d", &hour, &minute) != 2) {
+            continue;
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            arrivals = realloc(arrivals, sizeof(SimulatedArrival) * capacity);
+        }
+        SimulatedArrival* arrival = &arrivals[(*count)++];
+        arrival->emergencyId = record.emergencyId;
+        arrival->arrival = hour * 60 + minute;
+        arrival->priority = record.priority;
+        arrival->specialty = inferEmergencySpecialty(record.symptoms);
+        arrival->isWaiting = 0;
+    }
+    fclose(fp);
+
+    qsort(arrivals, *count, sizeof(SimulatedArrival), compareSimulatedArrivals);
+    return arrivals;
+}
+
+// Replay one day's recorded arrivals against the current roster and aging
+// setting, using the same doctor choice as live dispatch, and report waits,
+// throughput and doctor utilization. The live queue is not touched.
+void simulateEmergencyDay(const int packedDate) {
+    EmergencyRoster roster;
+    if (!loadEmergencyRoster(&roster)) {
+        printf("No doctors on the ER roster.\n");
+        return;
+    }
+
+    int arrivalCount;
+    SimulatedArrival* arrivals = loadSimulatedArrivals(packedDate, &arrivalCount);
+    if (arrivalCount == 0) {
+        printf("No emergency arrivals recorded on that date.\n");
+        free(arrivals);
+        freeEmergencyRoster(&roster);
+        return;
+    }
+
+    const int agingMinutes = getEmergencyAgingInterval();
+    SimulatedTreatment* active = malloc(sizeof(SimulatedTreatment) * arrivalCount);
+    int activeCount = 0;
+    int* doctorPatients = calloc(roster.count, sizeof(int));
+    int* doctorBusyMinutes = calloc(roster.count, sizeof(int));
+    int patientsByPriority[5] = {0}, totalWait[5] = {0}, maxWait[5] = {0};
+
+    int now = arrivals[0].arrival;
+    int nextArrival = 0, waitingCount = 0, treated = 0, peakQueue = 0, lastEnd = now;
+
+    while (treated < arrivalCount) {
+        // Free doctors whose treatments have ended
+        for (int i = 0; i < activeCount; ) {
+            if (active[i].end <= now) {
+                roster.doctors[active[i].doctor].currentPatients--;
+                active[i] = active[--activeCount];
+            } else {
+                i++;
+            }
+        }
+
+        while (nextArrival < arrivalCount && arrivals[nextArrival].arrival <= now) {
+            arrivals[nextArrival++].isWaiting = 1;
+            waitingCount++;
+        }
+        if (waitingCount > peakQueue) peakQueue = waitingCount;
+
+        // Dispatch the most urgent patient who can be seen, until none can
+        while (waitingCount > 0) {
+            int best = -1, bestDoctor = -1;
+            EmergencyPriority bestPriority = LOW;
+            for (int i = 0; i < nextArrival; i++) {
+                if (!arrivals[i].isWaiting) continue;
+                const EmergencyPriority effective = ageSimulatedPriority(arrivals[i].priority,
+                                                                         now - arrivals[i].arrival, agingMinutes);
+                if (best >= 0 && effective >= bestPriority) continue;
+
+                const int doctor = chooseEmergencyDoctor(&roster, arrivals[i].specialty, effective);
+                if (doctor < 0) continue;
+                best = i;
+                bestDoctor = doctor;
+                bestPriority = effective;
+            }
+            if (best < 0) break;
+
+            const SimulatedArrival* arrival = &arrivals[best];
+            const int wait = now - arrival->arrival;
+            const int duration = simulatedTreatmentMinutes[arrival->priority];
+
+            arrivals[best].isWaiting = 0;
+            waitingCount--;
+            treated++;
+
+            active[activeCount].doctor = bestDoctor;
+            active[activeCount].end = now + duration;
+            activeCount++;
+            roster.doctors[bestDoctor].currentPatients++;
+            doctorPatients[bestDoctor]++;
+            doctorBusyMinutes[bestDoctor] += duration;
+
+            patientsByPriority[arrival->priority]++;
+            totalWait[arrival->priority] += wait;
+            if (wait > maxWait[arrival->priority]) maxWait[arrival->priority] = wait;
+            if (now + duration > lastEnd) lastEnd = now + duration;
+        }
+
+        // Jump to the next arrival or treatment end
+        int next = INT_MAX;
+        if (nextArrival < arrivalCount) next = arrivals[nextArrival].arrival;
+        for (int i = 0; i < activeCount; i++) {
+            if (active[i].end < next) next = active[i].end;
+        }
+        if (next == INT_MAX) break;
+        now = next;
+    }
+
+    char dateStr[12];
+    unpackDate(packedDate, dateStr, sizeof(dateStr));
+    const int span = lastEnd - arrivals[0].arrival > 0 ? lastEnd - arrivals[0].arrival : 1;
+
+    printf("\n==== Simulated Day: %s ====\n", dateStr);
+    printf("Arrivals: %d   Doctors: %d   Aging: ", arrivalCount, roster.count);
+    if (agingMinutes > 0) {
+        printf("every %d min\n", agingMinutes);
+    } else {
+        printf("off\n");
+    }
+
+    printf("\n%-10s %-10s %-14s %-14s\n", "Priority", "Patients", "Avg Wait(min)", "Max Wait(min)");
+    printf("------------------------------------------------\n");
+    int allWait = 0, allMax = 0;
+    for (int priority = CRITICAL; priority <= LOW; priority++) {
+        if (patientsByPriority[priority] == 0) continue;
+        printf("%-10s %-10d %-14.1f %-14d\n", getPriorityString((EmergencyPriority)priority),
+               patientsByPriority[priority], (double)totalWait[priority] / patientsByPriority[priority],
+               maxWait[priority]);
+        allWait += totalWait[priority];
+        if (maxWait[priority] > allMax) allMax = maxWait[priority];
+    }
+    printf("%-10s %-10d %-14.1f %-14d\n", "ALL", treated, treated ? (double)allWait / treated : 0.0, allMax);
+
+    printf("\nPeak queue length: %d\n", peakQueue);
+    printf("Last patient done: %d min after first arrival\n", span);
+    printf("Throughput: %.2f patients/hour\n", treated * 60.0 / span);
+
+    printf("\n%-20s %-10s %-12s %-12s\n", "Doctor", "Patients", "Busy (min)", "Utilization");
+    printf("------------------------------------------------------\n");
+    for (int i = 0; i < roster.count; i++) {
+        printf("%-20s %-10d %-12d %.1f%%\n", roster.doctors[i].name, doctorPatients[i], doctorBusyMinutes[i],
+               100.0 * doctorBusyMinutes[i] / ((double)span * roster.doctors[i].maxPatients));
+    }
+
+    free(active);
+    free(doctorPatients);
+    free(doctorBusyMinutes);
+    free(arrivals);
+    freeEmergencyRoster(&roster);
+}
+
+static void viewDoctorLoads() {
+    EmergencyRoster roster;
+    if (!loadEmergencyRoster(&roster)) {
+        printf("\nNo doctors on the ER roster.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    countDoctorLoads(&roster);
+
+    printf("\n==== ER Doctors ====\n");
+    printf("%-20s %-40s %-8s\n", "Doctor", "Specialties", "Load");
+    printf("--------------------------------------------------------------------\n");
+    for (int i = 0; i < roster.count; i++) {
+        const EmergencyDoctor* doctor = &roster.doctors[i];
+        char specialties[128] = "";
+        for (int j = 0; j < doctor->specialtyCount; j++) {
+            if (j > 0) strcat(specialties, ", ");
+            strcat(specialties, doctor->specialties[j]);
+        }
+        printf("%-20s %-40s %d/%d\n", doctor->name, specialties, doctor->currentPatients, doctor->maxPatients);
+    }
+    freeEmergencyRoster(&roster);
+
+    printf("\nPress Enter to continue...");
+    getchar();
+}
+
+static void addDoctorToRoster() {
+    char name[50], specialties[128];
+    int maxPatients;
+
+    printf("\n==== Add ER Doctor ====\n");
+    printf("Doctor Name: ");
+    fgets(name, sizeof(name), stdin);
+    name[strcspn(name, "\n")] = 0;
+    if (strlen(name) == 0 || strchr(name, ',')) {
+        printf("Invalid name.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+
+    printf("Specialties, separated by ';' (blank for %s): ", GENERAL_SPECIALTY);
+    fgets(specialties, sizeof(specialties), stdin);
+    specialties[strcspn(specialties, "\n")] = 0;
+    if (strlen(specialties) == 0 || strchr(specialties, ',')) {
+        strcpy(specialties, GENERAL_SPECIALTY);
+    }
+
+    printf("Patients treated at once: ");
+    if (scanf("%d", &maxPatients) != 1 || maxPatients < 1) {
+        maxPatients = 1;
+    }
+    while (getchar() != '\n'); // Clear buffer
+
+    FILE *fp = fopen(ER_DOCTOR_DATAFILE, "a");
+    if (!fp) {
+        perror("Unable to open ER doctor roster");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    fprintf(fp, "%s,%s,%d\n", name, specialties, maxPatients);
+    fclose(fp);
+
+    printf("Doctor added to the ER roster.\n");
+    printf("Press Enter to continue...");
+    getchar();
+}
+
+static void runDispatch() {
+    EmergencyRoster roster;
+    if (!loadEmergencyRoster(&roster)) {
+        printf("\nNo doctors on the ER roster. Add doctors first.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+
+    printf("\n==== Dispatching Waiting Patients ====\n");
+    const int dispatched = dispatchWaitingPatients(&roster);
+    if (dispatched == 0) {
+        printf("No patients could be dispatched (queue empty or all suitable doctors busy).\n");
+    } else {
+        printf("\n%d patients dispatched.\n", dispatched);
+    }
+    freeEmergencyRoster(&roster);
+
+    printf("Press Enter to continue...");
+    getchar();
+}
+
+static void runDaySimulation() {
+    char dateStr[20];
+    printf("\nDate to replay (DD/MM/YYYY): ");
+    fgets(dateStr, sizeof(dateStr), stdin);
+    dateStr[strcspn(dateStr, "\n")] = 0;
+
+    const int packedDate = packDate(dateStr);
+    if (packedDate == 0) {
+        printf("Invalid date.\n");
+    } else {
+        simulateEmergencyDay(packedDate);
+    }
+
+    printf("\nPress Enter to continue...");
+    getchar();
+}
+
+void doctorDispatchMenu() {
+    int choice;
+
+    while (1) {
+        system("cls");
+        printf("==== Doctor Dispatch ====\n\n");
+        printf("1. View Doctors and Current Load\n");
+        printf("2. Add Doctor to Roster\n");
+        printf("3. Dispatch Waiting Patients\n");
+        printf("4. Simulate a Day of Arrivals\n");
+        printf("5. Back\n");
+        printf("\nChoice: ");
+
+        if (scanf("%d", &choice) != 1) {
+            while (getchar() != '\n') {}
+            printf("Invalid input. Press Enter to continue...");
+            getchar();
+            continue;
+        }
+        getchar();
+
+        switch (choice) {
+            case 1:
+                viewDoctorLoads();
+                break;
+            case 2:
+                addDoctorToRoster();
+                break;
+            case 3:
+                runDispatch();
+                break;
+            case 4:
+                runDaySimulation();
+                break;
+            case 5:
+                return;
+            default:
+                printf("Invalid choice. Press Enter to continue...");
+                getchar();
+        }
+    }
+}
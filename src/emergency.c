@@ -4,21 +4,34 @@
 #include <ctype.h>
 #include <time.h>
 #include "emergency.h"
+#include "emergency_queue.h"
 #include "patient.h"
 #include "appointment.h"
 #include "medicine.h"
+#include "emergency_medicines.h"
+#include "dispatch.h"
+#include "emergency_stats.h"
+#include "emergency_records.h"
 
 #define EMERGENCY_DATAFILE "data/emergency.csv"
-#define EMERGENCY_MEDICINE_DATAFILE "data/emergency_medicines.csv"
+#define EMERGENCY_STATE_FILE "data/emergency_state.csv"
 
-static EmergencyQueue emergencyQueue;
-static int maxEmergencyId = 5000;
-static int isQueueInitialized = 0;
+// Every row before this offset was discharged or superseded at the last
+// recovery. Updates are appended, so the prefix never changes and the next
+// recovery can start reading here instead of at the top of the file.
+static long activeRecordsOffset = 0;
+static int activeRecordsId = 0;     // emergencyId of the row at the offset, 0 if at end
+static int isEmergencyQueueRecovered = 0;
 
-static int tempPatientIdCounter = -1;
+// patientId (column 1) -> emergency visit rows
+static RowIndex emergencyPatientIndex = { .path = EMERGENCY_DATAFILE, .keyColumn = 1 };
+
+RowIndex* getEmergencyPatientIndex() {
+    return &emergencyPatientIndex;
+}
 
 int generateTempPatientId() {
-    return tempPatientIdCounter--;
+    return takeNextTempPatientId();
 }
 // Helper function to check if a string is effectively empty
 static int isEmergencyEffectivelyEmpty(const char* str) {
@@ -60,98 +73,169 @@ void getCurrentDateTime(char* date, char* ttime) {
 }
 
 int generateEmergencyId() {
-    return ++maxEmergencyId;
+    return takeNextEmergencyId();
 }
 
-const char* getPriorityString(const EmergencyPriority priority) {
-    switch(priority) {
-        case CRITICAL: return "CRITICAL";
-        case HIGH: return "HIGH";
-        case MEDIUM: return "MEDIUM";
-        case LOW: return "LOW";
-        default: return "UNKNOWN";
+// Parse one emergency.csv row. Returns 0 if the row is malformed.
+int parseEmergencyRecord(const char* line, EmergencyPatient* patient) {
+    int priority;
+    memset(patient, 0, sizeof(*patient));
+    if (sscanf(line, "%d,%d,%49[^,],%14[^,],%199[^,],%d,%10[^,],%8[^,],%19[^,],%49[^,],%199[^,],%8[^,],%299[^\n]",
+               &patient->emergencyId, &patient->patientId, patient->patientName, patient->patientPhone,
+               patient->symptoms, &priority, patient->arrivalDate, patient->arrivalTime, patient->status,
+               patient->treatingDoctor, patient->treatment, patient->dischargeTime, patient->notes) != 13) {
+        return 0;
     }
+    if (priority < CRITICAL || priority > LOW) priority = MEDIUM;
+    patient->priority = (EmergencyPriority)priority;
+    return 1;
 }
 
-void initializeEmergencyQueue() {
-    if (isQueueInitialized) return;
-
-    emergencyQueue.front = 0;
-    emergencyQueue.rear = -1;
-    emergencyQueue.count = 0;
-    isQueueInitialized = 1;
-}
+static void loadEmergencyState(int* maxEmergencyId, int* nextTempPatientId) {
+    FILE *fp = fopen(EMERGENCY_STATE_FILE, "r");
+    if (!fp) return;
 
-int isEmergencyQueueEmpty() {
-    return emergencyQueue.count == 0;
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+        char key[64];
+        long value;
+        if (sscanf(line, "%63[^,],%ld", key, &value) != 2) continue;
+
+        if (strcmp(key, "activeOffset") == 0) activeRecordsOffset = value;
+        else if (strcmp(key, "activeId") == 0) activeRecordsId = (int)value;
+        else if (strcmp(key, "maxEmergencyId") == 0 && value > *maxEmergencyId) *maxEmergencyId = (int)value;
+        else if (strcmp(key, "tempPatientId") == 0 && value < *nextTempPatientId) *nextTempPatientId = (int)value;
+    }
+    fclose(fp);
 }
 
-int isEmergencyQueueFull() {
-    return emergencyQueue.count == MAX_EMERGENCY_QUEUE;
-}
+static void saveEmergencyState() {
+    int maxEmergencyId, nextTempPatientId;
+    getEmergencyIdCounters(&maxEmergencyId, &nextTempPatientId);
 
-void enqueueEmergencyPatient(const EmergencyPatient patient) {
-    if (isEmergencyQueueFull()) {
-        printf("Emergency queue is full! Cannot add more patients.\n");
+    FILE *fp = fopen(EMERGENCY_STATE_FILE, "w");
+    if (!fp) {
+        perror("Unable to save emergency state");
         return;
     }
+    fprintf(fp, "activeOffset,%ld\n", activeRecordsOffset);
+    fprintf(fp, "activeId,%d\n", activeRecordsId);
+    fprintf(fp, "maxEmergencyId,%d\n", maxEmergencyId);
+    fprintf(fp, "tempPatientId,%d\n", nextTempPatientId);
+    fclose(fp);
+}
 
-    emergencyQueue.rear = (emergencyQueue.rear + 1) % MAX_EMERGENCY_QUEUE;
-    emergencyQueue.patients[emergencyQueue.rear] = patient;
-    emergencyQueue.count++;
+// Where recovery may start reading. Falls back to the top of the file if
+// the saved offset no longer lines up with the row it pointed at.
+static long findRecoveryStart(FILE* fp) {
+    fseek(fp, 0, SEEK_END);
+    const long fileSize = ftell(fp);
+    if (activeRecordsOffset <= 0 || activeRecordsOffset > fileSize) return 0;
 
-    // Sort queue by priority after adding
-    sortQueueByPriority();
+    fseek(fp, activeRecordsOffset - 1, SEEK_SET);
+    if (fgetc(fp) != '\n') return 0;
+
+    if (activeRecordsId != 0) {
+        char line[1024];
+        int emergencyId;
+        if (!fgets(line, sizeof(line), fp) || sscanf(line, "%d,", &emergencyId) != 1 ||
+            emergencyId != activeRecordsId) {
+            return 0;
+        }
+    }
+    return activeRecordsOffset;
 }
 
-EmergencyPatient dequeueEmergencyPatient() {
-    EmergencyPatient patient = {0};
+// Put every visit that is not yet discharged back in the queue, with its
+// medicines, and restore the ID counters. Only the terminal that creates the
+// shared queue does this; later terminals join the live queue as it is.
+void recoverEmergencyQueue() {
+    if (isEmergencyQueueRecovered) return;
+    isEmergencyQueueRecovered = 1;
+
+    if (!initializeEmergencyQueue()) return;
+    initializeEmergencyStats();
+
+    int maxEmergencyId = 0, nextTempPatientId = -1;
+    loadEmergencyState(&maxEmergencyId, &nextTempPatientId);
 
-    if (isEmergencyQueueEmpty()) {
-        printf("Emergency queue is empty!\n");
-        return patient;
+    // No other terminal is attached yet, so this is the time to compact
+    if (compactEmergencyRecords()) {
+        activeRecordsOffset = 0;
+        activeRecordsId = 0;
     }
+    refreshEmergencyRecordIndex();
 
-    patient = emergencyQueue.patients[emergencyQueue.front];
-    emergencyQueue.front = (emergencyQueue.front + 1) % MAX_EMERGENCY_QUEUE;
-    emergencyQueue.count--;
+    FILE *fp = fopen(EMERGENCY_DATAFILE, "r");
+    if (!fp) {
+        raiseEmergencyIdFloor(maxEmergencyId, nextTempPatientId);
+        publishEmergencyQueue();
+        return;
+    }
 
-    return patient;
-}
+    const long start = findRecoveryStart(fp);
+    fseek(fp, start, SEEK_SET);
 
-void sortQueueByPriority() {
-    if (emergencyQueue.count <= 1) return;
+    long firstActiveOffset = -1;
+    int firstActiveId = 0;
+    int recovered = 0;
+    char line[1024];
+    EmergencyPatient record;
 
-    EmergencyPatient temp[MAX_EMERGENCY_QUEUE];
-    int tempCount = 0;
+    long rowOffset = start;
+    while (fgets(line, sizeof(line), fp)) {
+        const long nextRowOffset = ftell(fp);
+        if (!parseEmergencyRecord(line, &record)) {
+            rowOffset = nextRowOffset;
+            continue;
+        }
 
-    // Copy all patients to temporary array
-    for (int i = 0; i < emergencyQueue.count; i++) {
-        const int index = (emergencyQueue.front + i) % MAX_EMERGENCY_QUEUE;
-        temp[tempCount++] = emergencyQueue.patients[index];
-    }
+        if (record.emergencyId > maxEmergencyId) maxEmergencyId = record.emergencyId;
+        if (record.patientId <= nextTempPatientId) nextTempPatientId = record.patientId - 1;
 
-    // Sort by priority (lower number = higher priority)
-    for (int i = 0; i < tempCount - 1; i++) {
-        for (int j = 0; j < tempCount - i - 1; j++) {
-            if (temp[j].priority > temp[j + 1].priority) {
-                const EmergencyPatient swap = temp[j];
-                temp[j] = temp[j + 1];
-                temp[j + 1] = swap;
+        if (strcmp(record.status, "Discharged") != 0 && isCurrentEmergencyRecord(record.emergencyId, rowOffset) &&
+            !findEmergencyPatient(record.emergencyId, NULL)) {
+            if (firstActiveOffset < 0) {
+                firstActiveOffset = rowOffset;
+                firstActiveId = record.emergencyId;
             }
+
+            // When treatment began was not saved; stamping it keeps the wait from being measured again
+            if (strcmp(record.status, "Waiting") != 0) record.treatmentStartEpoch = time(NULL);
+            record.medicineCount = findEmergencyMedicines(record.emergencyId, record.medicines,
+                                                          MAX_EMERGENCY_MEDICINES);
+            // Patients already in treatment go back on the board but not in line
+            const int isHeld = strcmp(record.status, "Waiting") == 0 ? enqueueEmergencyPatient(&record)
+                                                                      : updateEmergencyPatient(&record);
+            if (isHeld) recovered++;
         }
+        rowOffset = nextRowOffset;
+    }
+    fclose(fp);
+
+    activeRecordsOffset = firstActiveOffset >= 0 ? firstActiveOffset : rowOffset;
+    activeRecordsId = firstActiveId;
+    raiseEmergencyIdFloor(maxEmergencyId, nextTempPatientId);
+    saveEmergencyState();
+    publishEmergencyQueue();
+
+    if (recovered > 0) {
+        printf("Recovered %d emergency patients from the last session.\n", recovered);
     }
+}
 
-    // Copy back to queue
-    emergencyQueue.front = 0;
-    emergencyQueue.rear = tempCount - 1;
-    for (int i = 0; i < tempCount; i++) {
-        emergencyQueue.patients[i] = temp[i];
+const char* getPriorityString(const EmergencyPriority priority) {
+    switch(priority) {
+        case CRITICAL: return "CRITICAL";
+        case HIGH: return "HIGH";
+        case MEDIUM: return "MEDIUM";
+        case LOW: return "LOW";
+        default: return "UNKNOWN";
     }
 }
 
-EmergencyPatient createEmergencyEntry() {
-    EmergencyPatient patient = {0};
+// Fill an acquired record from interactive input. Returns 0 if input was rejected.
+int createEmergencyEntry(EmergencyPatient* patient) {
     char buffer[256];
 
     printf("\n==== Emergency Patient Registration ====\n");
@@ -167,10 +251,10 @@ EmergencyPatient createEmergencyEntry() {
         const Patient existingPatient = findPatientBySearch(3, idStr, NULL);
 
         if (existingPatient.patientId != 0) {
-            patient.patientId = existingPatient.patientId;
-            strncpy(patient.patientName, existingPatient.name, sizeof(patient.patientName) - 1);
-            strncpy(patient.patientPhone, existingPatient.phone, sizeof(patient.patientPhone) - 1);
-            printf("Found existing patient: %s\n", patient.patientName);
+            patient->patientId = existingPatient.patientId;
+            strncpy(patient->patientName, existingPatient.name, sizeof(patient->patientName) - 1);
+            strncpy(patient->patientPhone, existingPatient.phone, sizeof(patient->patientPhone) - 1);
+            printf("Found existing patient: %s\n", patient->patientName);
         } else {
             printf("Patient ID not found. Please register as new patient.\n");
             patientId = 0;
@@ -182,25 +266,23 @@ EmergencyPatient createEmergencyEntry() {
         getEmergencyInput("Patient Name: ", buffer, sizeof(buffer));
         if (isEmergencyEffectivelyEmpty(buffer)) {
             printf("Name cannot be empty!\n");
-            patient.emergencyId = -1;
-            return patient;
+            return 0;
         }
-        setEmergencyOrNA(patient.patientName, buffer, sizeof(patient.patientName));
+        setEmergencyOrNA(patient->patientName, buffer, sizeof(patient->patientName));
 
         getEmergencyInput("Patient Phone: ", buffer, sizeof(buffer));
         if (isEmergencyEffectivelyEmpty(buffer)) {
             printf("Phone cannot be empty!\n");
-            patient.emergencyId = -1;
-            return patient;
+            return 0;
         }
-        setEmergencyOrNA(patient.patientPhone, buffer, sizeof(patient.patientPhone));
+        setEmergencyOrNA(patient->patientPhone, buffer, sizeof(patient->patientPhone));
 
-        patient.patientId = 0; // Will be assigned when full registration is done later
+        patient->patientId = 0; // Will be assigned when full registration is done later
     }
 
     // Emergency-specific information
     getEmergencyInput("Symptoms/Chief Complaint: ", buffer, sizeof(buffer));
-    setEmergencyOrNA(patient.symptoms, buffer, sizeof(patient.symptoms));
+    setEmergencyOrNA(patient->symptoms, buffer, sizeof(patient->symptoms));
 
     // Priority assessment
     printf("\nPriority Assessment:\n");
@@ -210,32 +292,24 @@ EmergencyPatient createEmergencyEntry() {
     printf("4. LOW (Non-urgent)\n");
     getEmergencyInput("Select Priority (1-4): ", buffer, sizeof(buffer));
     const int priority = atoi(buffer);
-    patient.priority = (priority >= 1 && priority <= 4) ? (EmergencyPriority)priority : MEDIUM;
+    patient->priority = (priority >= 1 && priority <= 4) ? (EmergencyPriority)priority : MEDIUM;
 
     // Set timestamps and status
-    getCurrentDateTime(patient.arrivalDate, patient.arrivalTime);
-    strcpy(patient.status, "Waiting");
-    strcpy(patient.treatingDoctor, "N/A");
-    strcpy(patient.treatment, "N/A");
-    patient.medicineCount = 0;
-    strcpy(patient.dischargeTime, "N/A");
-    strcpy(patient.notes, "N/A");
+    getCurrentDateTime(patient->arrivalDate, patient->arrivalTime);
+    strcpy(patient->status, "Waiting");
+    strcpy(patient->treatingDoctor, "N/A");
+    strcpy(patient->treatment, "N/A");
+    patient->medicineCount = 0;
+    strcpy(patient->dischargeTime, "N/A");
+    strcpy(patient->notes, "N/A");
 
-    patient.emergencyId = generateEmergencyId();
+    patient->emergencyId = generateEmergencyId();
 
-    return patient;
+    return 1;
 }
 
 void addPatientToEmergencyQueue() {
-    if (isEmergencyQueueFull()) {
-        printf("\nEmergency queue is full. Cannot add more patients.\n");
-        printf("Press Enter to continue...");
-        getchar();
-        return;
-    }
-
     EmergencyPatient newPatient = {0};
-    char buffer[256];
     int patientId = 0;
     Patient existingPatient = {0};
 
@@ -304,61 +378,191 @@ void addPatientToEmergencyQueue() {
     strcpy(newPatient.notes, "N/A");
 
     newPatient.emergencyId = generateEmergencyId();
-    enqueueEmergencyPatient(newPatient);
+    if (!enqueueEmergencyPatient(&newPatient)) {
+        printf("\nOut of memory. Cannot add more patients.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
     saveEmergencyRecord(&newPatient);
+    recordEmergencyArrival(&newPatient);
 
     printf("\nPatient added to emergency queue with ID %d.\n", newPatient.emergencyId);
     printf("Press Enter to continue...");
     getchar();
 }
 
-void viewEmergencyQueue() {
-    if (isEmergencyQueueEmpty()) {
-        printf("\nEmergency queue is empty.\n");
+// Register many unregistered arrivals at once, e.g. during a mass-casualty
+// incident. The whole batch is queued under one lock and saved with one write.
+void batchEmergencyIntake() {
+    printf("\n==== Mass Casualty Intake ====\n");
+    printf("Enter one patient per line as: Name,Phone,Symptoms,Priority (1-4)\n");
+    printf("Use N/A for unknown fields. Leave a line empty to finish.\n\n");
+
+    int capacity = 16, count = 0;
+    EmergencyPatient* patients = malloc(sizeof(EmergencyPatient) * capacity);
+    if (!patients) {
+        printf("Out of memory.\n");
         printf("Press Enter to continue...");
         getchar();
         return;
     }
 
-    printf("\n==== Emergency Queue (%d patients) ====\n", emergencyQueue.count);
-    printf("%-5s %-10s %-20s %-15s %-10s %-15s %-12s\n",
-           "Pos", "Emerg ID", "Patient Name", "Phone", "Priority", "Arrival Time", "Status");
-    printf("---------------------------------------------------------------------------------\n");
+    char arrivalDate[11], arrivalTime[9];
+    const time_t now = time(NULL);
+    const struct tm* t = localtime(&now);
+    strftime(arrivalDate, sizeof(arrivalDate), "%d/%m/%Y", t);
+    strftime(arrivalTime, sizeof(arrivalTime), "%H:%M", t);
+
+    char buffer[512];
+    while (1) {
+        char prompt[32];
+        snprintf(prompt, sizeof(prompt), "Patient %d: ", count + 1);
+        getEmergencyInput(prompt, buffer, sizeof(buffer));
+        if (isEmergencyEffectivelyEmpty(buffer)) break;
+
+        if (count == capacity) {
+            EmergencyPatient* grown = realloc(patients, sizeof(EmergencyPatient) * capacity * 2);
+            if (!grown) {
+                printf("Out of memory. Registering the %d patients entered so far.\n", count);
+                break;
+            }
+            patients = grown;
+            capacity *= 2;
+        }
+
+        EmergencyPatient* patient = &patients[count];
+        memset(patient, 0, sizeof(*patient));
+        int priority;
+        if (sscanf(buffer, " %49[^,],%14[^,],%199[^,],%d", patient->patientName, patient->patientPhone,
+                   patient->symptoms, &priority) != 4) {
+            printf("Could not read that line, please re-enter it.\n");
+            continue;
+        }
+        patient->priority = (priority >= 1 && priority <= 4) ? (EmergencyPriority)priority : MEDIUM;
+
+        strcpy(patient->arrivalDate, arrivalDate);
+        strcpy(patient->arrivalTime, arrivalTime);
+        strcpy(patient->status, "Waiting");
+        strcpy(patient->treatingDoctor, "N/A");
+        strcpy(patient->treatment, "N/A");
+        strcpy(patient->dischargeTime, "N/A");
+        strcpy(patient->notes, "N/A");
+        patient->patientId = generateTempPatientId();
+        patient->emergencyId = generateEmergencyId();
+        count++;
+    }
+
+    if (count == 0) {
+        free(patients);
+        printf("No patients entered.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
 
-    for (int i = 0; i < emergencyQueue.count; i++) {
-        const int index = (emergencyQueue.front + i) % MAX_EMERGENCY_QUEUE;
-        EmergencyPatient* p = &emergencyQueue.patients[index];
+    const int queued = enqueueEmergencyPatients(patients, count);
+    if (queued < count) {
+        printf("\nOut of memory. Only %d of %d patients could be queued.\n", queued, count);
+    }
+    if (!appendEmergencyRecords(patients, queued)) {
+        printf("Error saving emergency records.\n");
+    }
+    recordEmergencyArrivals(patients, queued);
 
-        printf("%-5d %-10d %-20s %-15s %-10s %-15s %-12s\n",
-               i + 1, p->emergencyId, p->patientName, p->patientPhone,
-               getPriorityString(p->priority), p->arrivalTime, p->status);
+    printf("\n%-10s %-12s %-25s %-10s\n", "Emerg ID", "Patient ID", "Name", "Priority");
+    printf("----------------------------------------------------------\n");
+    for (int i = 0; i < queued; i++) {
+        printf("%-10d %-12d %-25s %-10s\n", patients[i].emergencyId, patients[i].patientId,
+               patients[i].patientName, getPriorityString(patients[i].priority));
     }
+    printf("\n%d patients added to the emergency queue.\n", queued);
+    free(patients);
+
+    printf("Press Enter to continue...");
+    getchar();
+}
+
+// Waiting patients in treatment order, then those already in treatment
+static int compareBoardPatients(const void* a, const void* b) {
+    const EmergencyPatient* left = a;
+    const EmergencyPatient* right = b;
+    const int leftWaiting = strcmp(left->status, "Waiting") == 0;
+    const int rightWaiting = strcmp(right->status, "Waiting") == 0;
+    if (leftWaiting != rightWaiting) return rightWaiting - leftWaiting;
+    if (leftWaiting && left->effectivePriority != right->effectivePriority) {
+        return left->effectivePriority < right->effectivePriority ? -1 : 1;
+    }
+    return (left->arrivalSequence > right->arrivalSequence) - (left->arrivalSequence < right->arrivalSequence);
+}
+
+void viewEmergencyQueue() {
+    int heldCount;
+    EmergencyPatient* held = copyEmergencyBoard(&heldCount);
+    if (heldCount == 0) {
+        free(held);
+        printf("\nEmergency queue is empty.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    qsort(held, heldCount, sizeof(EmergencyPatient), compareBoardPatients);
+
+    printf("\n==== Emergency Queue (%d patients) ====\n", heldCount);
+    printf("%-5s %-10s %-20s %-15s %-10s %-10s %-15s %-12s\n",
+           "Pos", "Emerg ID", "Patient Name", "Phone", "Priority", "Triage", "Arrival Time", "Status");
+    printf("--------------------------------------------------------------------------------------------\n");
+
+    // Only waiting patients have a place in line
+    int position = 0;
+    for (int i = 0; i < heldCount; i++) {
+        const EmergencyPatient* p = &held[i];
+        char pos[12] = "-";
+        if (strcmp(p->status, "Waiting") == 0) snprintf(pos, sizeof(pos), "%d", ++position);
+
+        printf("%-5s %-10d %-20s %-15s %-10s %-10s %-15s %-12s\n",
+               pos, p->emergencyId, p->patientName, p->patientPhone,
+               getPriorityString(p->effectivePriority), getPriorityString(p->priority),
+               p->arrivalTime, p->status);
+    }
+    free(held);
 
     printf("\nPress Enter to continue...");
     getchar();
 }
 
+// Put back the stock taken for medicines[from..] of a treatment
+static void returnTreatmentStock(const EmergencyPatient* patient, const int from) {
+    for (int i = from; i < patient->medicineCount; i++) {
+        const EmergencyMedicine* medicine = &patient->medicines[i];
+        int available;
+        if (medicine->medicineId != 0 && !adjustMedicineStock(medicine->medicineId, medicine->quantity, &available)) {
+            printf("Could not return %d units of %s to stock.\n", medicine->quantity, medicine->medicineName);
+        }
+    }
+}
+
 void treatNextPatient() {
-    if (isEmergencyQueueEmpty()) {
+    // Claimed atomically, so no other terminal can start treating them too
+    EmergencyPatient claimed;
+    if (!claimNextEmergencyPatient(&claimed)) {
         printf("\nNo patients in emergency queue.\n");
         printf("Press Enter to continue...");
         getchar();
         return;
     }
 
-    EmergencyPatient patient = dequeueEmergencyPatient();
+    EmergencyPatient* patient = &claimed;
     char buffer[256];
 
     printf("\n==== Treating Patient ====\n");
-    showEmergencyPatient(&patient);
-
-    strcpy(patient.status, "In Treatment");
+    showEmergencyPatient(patient);
 
     getEmergencyInput("Treating Doctor: ", buffer, sizeof(buffer));
-    setEmergencyOrNA(patient.treatingDoctor, buffer, sizeof(patient.treatingDoctor));
+    setEmergencyOrNA(patient->treatingDoctor, buffer, sizeof(patient->treatingDoctor));
 
     getEmergencyInput("Treatment/Diagnosis: ", buffer, sizeof(buffer));
-    setEmergencyOrNA(patient.treatment, buffer, sizeof(patient.treatment));
+    setEmergencyOrNA(patient->treatment, buffer, sizeof(patient->treatment));
 
     // Add medicines if needed
     printf("\nWould you like to add medicines? (y/n): ");
@@ -366,18 +570,28 @@ void treatNextPatient() {
     scanf("%c", &choice);
     getchar();
 
+    const int previousMedicineCount = patient->medicineCount;
     if (choice == 'y' || choice == 'Y') {
-        addMedicineToTreatment(&patient);
+        addMedicineToTreatment(patient);
     }
 
     getEmergencyInput("Additional Notes: ", buffer, sizeof(buffer));
-    setEmergencyOrNA(patient.notes, buffer, sizeof(patient.notes));
+    setEmergencyOrNA(patient->notes, buffer, sizeof(patient->notes));
+
+    // Medicines that were never recorded were never given, so return them to stock
+    const int isSaved = saveEmergencyRecord(patient);
+    if (!isSaved) {
+        printf("Error saving treatment record.\n");
+        returnTreatmentStock(patient, previousMedicineCount);
+        patient->medicineCount = previousMedicineCount;
+    }
 
-    // Put patient back in queue with updated status
-    enqueueEmergencyPatient(patient);
-    saveEmergencyRecord(&patient);
+    // Keep the updated record on the board; patients in treatment are not queued
+    if (!updateEmergencyPatient(patient)) {
+        printf("Out of memory! Patient record could not be updated on the board.\n");
+    }
 
-    printf("\nPatient treatment updated successfully!\n");
+    if (isSaved) printf("\nPatient treatment updated successfully!\n");
     printf("Press Enter to continue...");
     getchar();
 }
@@ -398,7 +612,7 @@ void addMedicineToTreatment(EmergencyPatient* patient) {
 
         if (medicineId == 0) break;
 
-        const Medicine medicine = findMedicine(medicineId);
+        Medicine medicine = findMedicine(medicineId);
         if (medicine.medicineId == 0) {
             printf("Medicine not found in inventory!\n");
             getEmergencyInput("Medicine Name: ", buffer, sizeof(buffer));
@@ -406,6 +620,7 @@ void addMedicineToTreatment(EmergencyPatient* patient) {
                            buffer, sizeof(patient->medicines[patient->medicineCount].medicineName));
             patient->medicines[patient->medicineCount].medicineId = 0;
         } else {
+            medicine = chooseMedicineLot(&medicine);
             patient->medicines[patient->medicineCount].medicineId = medicine.medicineId;
             strncpy(patient->medicines[patient->medicineCount].medicineName,
                    medicine.name, sizeof(patient->medicines[patient->medicineCount].medicineName) - 1);
@@ -413,6 +628,18 @@ void addMedicineToTreatment(EmergencyPatient* patient) {
 
         getEmergencyInput("Quantity: ", buffer, sizeof(buffer));
         patient->medicines[patient->medicineCount].quantity = atoi(buffer);
+        if (patient->medicines[patient->medicineCount].quantity <= 0) {
+            printf("Invalid quantity! Skipping this medicine.\n");
+            continue;
+        }
+
+        // Inventory medicines are taken out of stock as they are given
+        int available;
+        if (medicine.medicineId != 0 &&
+            !reserveMedicineStock(medicine.medicineId, patient->medicines[patient->medicineCount].quantity, &available)) {
+            printf("Insufficient stock! Only %d available.\n", available < 0 ? 0 : available);
+            continue;
+        }
 
         getEmergencyInput("Dosage: ", buffer, sizeof(buffer));
         setEmergencyOrNA(patient->medicines[patient->medicineCount].dosage,
@@ -445,43 +672,15 @@ void dischargePatient() {
     }
     getchar();
 
-    FILE *fp = fopen("data/emergency_records.csv", "r");
-    if (!fp) {
-        printf("No emergency data found.\n");
-        printf("Press Enter to return to menu...");
-        getchar();
-        return;
-    }
-
-    char emergencyLine[512];
-    int found = 0;
-    int lineEmergencyId, emergPatientId, priority;
-    char patientName[50], phoneNumber[20], symptoms[200], arrivalDate[20], arrivalTime[10];
-    char status[20], assignedDoctor[50], treatment[200], notes[200];
-
-    while (fgets(emergencyLine, sizeof(emergencyLine), fp)) {
-        // Use a temporary variable for the ID from the current line
-        int currentId;
-        if (sscanf(emergencyLine, "%d,", &currentId) == 1 && currentId == emergencyId) {
-            // If the ID matches, parse the rest of the line
-            if (sscanf(emergencyLine, "%d,%d,%49[^,],%19[^,],%199[^,],%d,%19[^,],%9[^,],%19[^,],%49[^,],%199[^,],%199[^\n]",
-                       &lineEmergencyId, &emergPatientId, patientName, phoneNumber, symptoms, &priority,
-                       arrivalDate, arrivalTime, status, assignedDoctor, treatment, notes) == 12) {
-                found = 1;
-                break;
-            }
-        }
-    }
-    fclose(fp);
-
-    if (!found) {
+    EmergencyPatient record;
+    if (!findEmergencyRecord(emergencyId, &record)) {
         printf("Emergency record with ID %d not found!\n", emergencyId);
         printf("Press Enter to return to menu...");
         getchar();
         return;
     }
 
-    if (strcmp(status, "Discharged") == 0) {
+    if (strcmp(record.status, "Discharged") == 0) {
         printf("Patient already discharged!\n");
         printf("Press Enter to return to menu...");
         getchar();
@@ -490,7 +689,7 @@ void dischargePatient() {
 
     // Check if patient exists in main system using existing findPatient function
     char patientIdStr[10];
-    sprintf(patientIdStr, "%d", emergPatientId);
+    sprintf(patientIdStr, "%d", record.patientId);
     Patient existingPatient = findPatientBySearch(1, patientIdStr, NULL); // Search by ID
     int patientAdded = 0;
 
@@ -499,9 +698,9 @@ void dischargePatient() {
 
         // Create new patient from emergency data
         Patient newPatient = {0};
-        newPatient.patientId = emergPatientId;
-        strcpy(newPatient.name, patientName);
-        strcpy(newPatient.phone, phoneNumber);
+        newPatient.patientId = record.patientId;
+        strcpy(newPatient.name, record.patientName);
+        strcpy(newPatient.phone, record.patientPhone);
 
         // Get additional required information
         char buffer[256];
@@ -573,9 +772,9 @@ void dischargePatient() {
     char followUpRequired;
 
     printf("\n==== Discharge Information ====\n");
-    printf("Patient: %s (ID: %d)\n", patientName, emergPatientId);
-    printf("Original Symptoms: %s\n", symptoms);
-    printf("Treatment Given: %s\n", treatment);
+    printf("Patient: %s (ID: %d)\n", record.patientName, record.patientId);
+    printf("Original Symptoms: %s\n", record.symptoms);
+    printf("Treatment Given: %s\n", record.treatment);
 
     printf("\nEnter discharge details:\n");
     printf("Final Treatment Notes: ");
@@ -590,38 +789,22 @@ void dischargePatient() {
     scanf(" %c", &followUpRequired);
     getchar();
 
-    // Update emergency record to discharged
-    FILE *tempFp = fopen("data/emergency_temp.csv", "w");
-    fp = fopen("data/emergency_records.csv", "r");
-
-    if (!fp || !tempFp) {
+    // Append the discharged version of the record
+    char dischargeDate[11];
+    getCurrentDateTime(dischargeDate, record.dischargeTime);
+    strcpy(record.status, "Discharged");
+    strcpy(record.treatment, finalTreatment);
+    strcpy(record.notes, dischargeNotes);
+    if (!appendEmergencyRecord(&record)) {
         printf("Error updating emergency record.\n");
-        if (fp) fclose(fp);
-        if (tempFp) fclose(tempFp);
         printf("Press Enter to return to menu...");
         getchar();
         return;
     }
+    recordEmergencyDischarge(emergencyId, record.priority, record.arrivalDate, record.arrivalTime, time(NULL));
 
-    char line[512];
-    while (fgets(line, sizeof(line), fp)) {
-        int lineEmergencyId;
-        if (sscanf(line, "%d,", &lineEmergencyId) == 1 && lineEmergencyId == emergencyId) {
-            // Update this record with discharge information
-            fprintf(tempFp, "%d,%d,%s,%s,%s,%d,%s,%s,Discharged,%s,%s,%s\n",
-                    emergencyId, emergPatientId, patientName, phoneNumber, symptoms,
-                    priority, arrivalDate, arrivalTime, assignedDoctor, finalTreatment, dischargeNotes);
-        } else {
-            fputs(line, tempFp);
-        }
-    }
-
-    fclose(fp);
-    fclose(tempFp);
-
-    // Replace original file
-    remove("data/emergency_records.csv");
-    rename("data/emergency_temp.csv", "data/emergency_records.csv");
+    // Hand the patient's queue record back to the pool
+    removeEmergencyPatient(emergencyId);
 
     // Create follow-up appointment if required
     if (followUpRequired == 'y' || followUpRequired == 'Y') {
@@ -641,21 +824,21 @@ void dischargePatient() {
         fgets(appointmentTime, sizeof(appointmentTime), stdin);
         appointmentTime[strcspn(appointmentTime, "\n")] = 0;
 
-        printf("Doctor Name [%s]: ", assignedDoctor);
+        printf("Doctor Name [%s]: ", record.treatingDoctor);
         fgets(appointmentDoctor, sizeof(appointmentDoctor), stdin);
         appointmentDoctor[strcspn(appointmentDoctor, "\n")] = 0;
         if (strlen(appointmentDoctor) == 0) {
-            strcpy(appointmentDoctor, assignedDoctor);
+            strcpy(appointmentDoctor, record.treatingDoctor);
         }
 
         // Create appointment purpose based on emergency details
         snprintf(appointmentPurpose, sizeof(appointmentPurpose),
-                 "Follow-up for Emergency ID: %d - %s", emergencyId, symptoms);
+                 "Follow-up for Emergency ID: %d - %s", emergencyId, record.symptoms);
 
         // Create and save appointment
         Appointment appointment = {0};
         appointment.appointmentId = generateAppointmentId();
-        appointment.patientId = emergPatientId;
+        appointment.patientId = record.patientId;
         strcpy(appointment.doctorName, appointmentDoctor);
         strcpy(appointment.date, appointmentDate);
         strcpy(appointment.time, appointmentTime);
@@ -681,7 +864,7 @@ void dischargePatient() {
 
     printf("\nPatient discharged successfully!\n");
     printf("Emergency ID: %d\n", emergencyId);
-    printf("Patient: %s (ID: %d)\n", patientName, emergPatientId);
+    printf("Patient: %s (ID: %d)\n", record.patientName, record.patientId);
     printf("Status: Discharged\n");
 
     if (patientAdded) {
@@ -726,6 +909,9 @@ void showEmergencyPatient(EmergencyPatient* patient) {
     printf("Phone: %s\n", patient->patientPhone);
     printf("Symptoms: %s\n", patient->symptoms);
     printf("Priority: %s\n", getPriorityString(patient->priority));
+    if (patient->effectivePriority != 0 && patient->effectivePriority != patient->priority) {
+        printf("Aged Priority: %s\n", getPriorityString(patient->effectivePriority));
+    }
     printf("Arrival: %s %s\n", patient->arrivalDate, patient->arrivalTime);
     printf("Status: %s\n", patient->status);
     printf("Treating Doctor: %s\n", patient->treatingDoctor);
@@ -747,93 +933,35 @@ void showEmergencyPatient(EmergencyPatient* patient) {
     printf("====================================\n");
 }
 
-void saveEmergencyRecord(EmergencyPatient* patient) {
-    // Part 1: Save/Update the main emergency record in emergency_records.csv
-    FILE *fp = fopen(EMERGENCY_DATAFILE, "r");
-    FILE *tempFp = fopen("data/emergency_temp.csv", "w");
-
-    if (!tempFp) {
-        perror("Unable to create temporary emergency file");
-        if (fp) fclose(fp);
-        return;
-    }
-
-    int recordExists = 0;
-    if (fp) {
-        char line[1024];
-        while (fgets(line, sizeof(line), fp)) {
-            int currentId;
-            if (sscanf(line, "%d,", &currentId) == 1 && currentId == patient->emergencyId) {
-                // This is the record to update, so write the new data
-                fprintf(tempFp, "%d,%d,%s,%s,%s,%d,%s,%s,%s,%s,%s,%s,%s\n",
-                        patient->emergencyId, patient->patientId, patient->patientName,
-                        patient->patientPhone, patient->symptoms, patient->priority,
-                        patient->arrivalDate, patient->arrivalTime, patient->status,
-                        patient->treatingDoctor, patient->treatment, patient->dischargeTime,
-                        patient->notes);
-                recordExists = 1;
-            } else {
-                // Copy other lines as they are
-                fputs(line, tempFp);
-            }
-        }
-        fclose(fp);
-    }
-
-    // If the record was not found in the file, append it
-    if (!recordExists) {
-        fprintf(tempFp, "%d,%d,%s,%s,%s,%d,%s,%s,%s,%s,%s,%s,%s\n",
-                patient->emergencyId, patient->patientId, patient->patientName,
-                patient->patientPhone, patient->symptoms, patient->priority,
-                patient->arrivalDate, patient->arrivalTime, patient->status,
-                patient->treatingDoctor, patient->treatment, patient->dischargeTime,
-                patient->notes);
-    }
-
-    fclose(tempFp);
-
-    // Replace the old file with the updated one
-    remove(EMERGENCY_DATAFILE);
-    rename("data/emergency_temp.csv", EMERGENCY_DATAFILE);
-
+// Returns 0 if either part could not be written
+int saveEmergencyRecord(EmergencyPatient* patient) {
+    // Part 1: Append the new version of the main record to emergency.csv
+    if (!appendEmergencyRecord(patient)) return 0;
 
     // Part 2: Save the medicine records to emergency_medicine.csv
-    if (patient->medicineCount > 0) {
-        FILE *medFp = fopen(EMERGENCY_MEDICINE_DATAFILE, "a");
-        if (!medFp) {
-            perror("Unable to open emergency medicine data file");
-            return;
-        }
-
-        for (int i = 0; i < patient->medicineCount; i++) {
-            EmergencyMedicine *med = &patient->medicines[i];
-            fprintf(medFp, "%d,%d,%s,%d,%s,%s\n",
-                    patient->emergencyId,
-                    med->medicineId,
-                    med->medicineName,
-                    med->quantity,
-                    med->dosage,
-                    med->instructions);
-        }
-        fclose(medFp);
-    }
+    return appendEmergencyMedicines(patient->emergencyId, patient->medicines, patient->medicineCount);
 }
 
 void emergencyPatientQueue() {
-    initializeEmergencyQueue();
+    recoverEmergencyQueue();
     int choice;
 
     while (1) {
         system("cls");
         printf("==== Emergency Patient Queue ====\n\n");
-        printf("Queue Status: %d/%d patients\n", emergencyQueue.count, MAX_EMERGENCY_QUEUE);
+        printf("Queue Status: %d patients waiting (%s queue)\n", getEmergencyQueueCount(),
+               isEmergencyQueueShared() ? "shared" : "local");
         printf("\n1. Add Emergency Patient\n");
         printf("2. View Emergency Queue\n");
         printf("3. Treat Next Patient\n");
         printf("4. Discharge Patient\n");
         printf("5. Search Emergency Patient\n");
         printf("6. Generate Emergency Report\n");
-        printf("7. Back to Main Menu\n");
+        printf("7. Re-triage Waiting Patient\n");
+        printf("8. Priority Aging Settings\n");
+        printf("9. Doctor Dispatch\n");
+        printf("10. Mass Casualty Intake\n");
+        printf("11. Back to Main Menu\n");
         printf("\nChoice: ");
 
         if (scanf("%d", &choice) != 1) {
@@ -864,6 +992,18 @@ void emergencyPatientQueue() {
                 generateEmergencyReport();
                 break;
             case 7:
+                retriageEmergencyPatient();
+                break;
+            case 8:
+                configurePriorityAging();
+                break;
+            case 9:
+                doctorDispatchMenu();
+                break;
+            case 10:
+                batchEmergencyIntake();
+                break;
+            case 11:
                 return;
             default:
                 printf("Invalid choice. Press Enter to continue...");
@@ -872,8 +1012,85 @@ void emergencyPatientQueue() {
     }
 }
 
+void retriageEmergencyPatient() {
+    int emergencyId, priority;
+    printf("Enter Emergency ID to re-triage: ");
+    if (scanf("%d", &emergencyId) != 1) {
+        while (getchar() != '\n'); // Clear buffer
+        printf("Invalid input.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    getchar();
+
+    EmergencyPatient patient;
+    if (!findEmergencyPatient(emergencyId, &patient) || strcmp(patient.status, "Waiting") != 0) {
+        printf("No waiting emergency patient with ID %d.\n", emergencyId);
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+
+    printf("Patient: %s\n", patient.patientName);
+    printf("Current Priority: %s (effective %s)\n",
+           getPriorityString(patient.priority), getPriorityString(patient.effectivePriority));
+    printf("New Priority (1-Critical, 2-High, 3-Medium, 4-Low): ");
+    if (scanf("%d", &priority) != 1 || priority < CRITICAL || priority > LOW) {
+        while (getchar() != '\n'); // Clear buffer
+        printf("Invalid priority.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    getchar();
+
+    // Another terminal may have claimed them in the meantime
+    if (!changeEmergencyPriority(emergencyId, (EmergencyPriority)priority, &patient)) {
+        printf("Patient %d is no longer waiting in the queue.\n", emergencyId);
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    saveEmergencyRecord(&patient);
+
+    printf("Priority updated to %s (effective %s).\n",
+           getPriorityString(patient.priority), getPriorityString(patient.effectivePriority));
+    printf("Press Enter to continue...");
+    getchar();
+}
+
+void configurePriorityAging() {
+    int minutes;
+    const int current = getEmergencyAgingInterval();
+
+    printf("\n==== Priority Aging ====\n");
+    if (current > 0) {
+        printf("Waiting patients move up one priority level every %d minutes.\n", current);
+    } else {
+        printf("Priority aging is disabled.\n");
+    }
+    printf("New interval in minutes (0 to disable): ");
+    if (scanf("%d", &minutes) != 1 || minutes < 0) {
+        while (getchar() != '\n'); // Clear buffer
+        printf("Invalid interval.\n");
+        printf("Press Enter to continue...");
+        getchar();
+        return;
+    }
+    getchar();
+
+    if (setEmergencyAgingInterval(minutes)) {
+        printf("Priority aging %s.\n", minutes > 0 ? "updated" : "disabled");
+    } else {
+        printf("Priority aging could not be changed.\n");
+    }
+    printf("Press Enter to continue...");
+    getchar();
+}
+
 void searchEmergencyPatient() {
-    if (isEmergencyQueueEmpty()) {
+    if (getEmergencyBoardCount() == 0) {
         printf("\nNo patients in emergency queue.\n");
         printf("Press Enter to continue...");
         getchar();
@@ -885,14 +1102,12 @@ void searchEmergencyPatient() {
     scanf("%d", &emergencyId);
     getchar();
 
-    for (int i = 0; i < emergencyQueue.count; i++) {
-        const int index = (emergencyQueue.front + i) % MAX_EMERGENCY_QUEUE;
-        if (emergencyQueue.patients[index].emergencyId == emergencyId) {
-            showEmergencyPatient(&emergencyQueue.patients[index]);
-            printf("Press Enter to continue...");
-            getchar();
-            return;
-        }
+    EmergencyPatient patient;
+    if (findEmergencyPatient(emergencyId, &patient)) {
+        showEmergencyPatient(&patient);
+        printf("Press Enter to continue...");
+        getchar();
+        return;
     }
 
     printf("Emergency patient with ID %d not found in queue.\n", emergencyId);
@@ -902,11 +1117,15 @@ void searchEmergencyPatient() {
 
 void generateEmergencyReport() {
     printf("\n==== Emergency Department Report ====\n");
-    printf("Current Queue Status: %d patients\n", emergencyQueue.count);
+    int heldCount;
+    EmergencyPatient* held = copyEmergencyBoard(&heldCount);
+    printf("Current Queue Status: %d patients\n", heldCount);
 
-    if (emergencyQueue.count == 0) {
+    if (heldCount == 0) {
+        free(held);
         printf("No patients currently in emergency queue.\n");
-        printf("Press Enter to continue...");
+        printEmergencyAnalytics();
+        printf("\nPress Enter to continue...");
         getchar();
         return;
     }
@@ -914,15 +1133,15 @@ void generateEmergencyReport() {
     int priorities[5] = {0}; // Count for each priority level
     int waiting = 0, inTreatment = 0;
 
-    for (int i = 0; i < emergencyQueue.count; i++) {
-        const int index = (emergencyQueue.front + i) % MAX_EMERGENCY_QUEUE;
-        const EmergencyPatient* p = &emergencyQueue.patients[index];
+    for (int i = 0; i < heldCount; i++) {
+        const EmergencyPatient* p = &held[i];
 
         priorities[p->priority]++;
 
         if (strcmp(p->status, "Waiting") == 0) waiting++;
         else if (strcmp(p->status, "In Treatment") == 0) inTreatment++;
     }
+    free(held);
 
     printf("\nPriority Breakdown:\n");
     printf("CRITICAL: %d patients\n", priorities[CRITICAL]);
@@ -934,6 +1153,8 @@ void generateEmergencyReport() {
     printf("Waiting: %d patients\n", waiting);
     printf("In Treatment: %d patients\n", inTreatment);
 
+    printEmergencyAnalytics();
+
     printf("\nPress Enter to continue...");
     getchar();
 }
\ No newline at end of file
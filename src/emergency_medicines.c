@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emergency_medicines.h"
+#include "hashmap.h"
+
+#define EMERGENCY_MEDICINE_DATAFILE "data/emergency_medicines.csv"
+#define EMERGENCY_MEDICINE_INDEXFILE "data/emergency_medicines.idx"
+#define EMERGENCY_MEDICINE_INDEX_VERSION 3
+
+typedef struct {
+    long offset;
+    long length;
+    int rowCount;
+} MedicineBlock;
+
+static MedicineBlock* blocks = NULL;
+static int blockCount = 0;
+static int blockCapacity = 0;
+static IntMap blockIndex;           // emergencyId -> latest block
+static long indexedSize = 0;        // Bytes of the data file covered by the index
+static long legacyEnd = 0;          // Data written before the index format existed ends here
+static int isIndexLoaded = 0;
+
+static void putBlock(const int emergencyId, const long offset, const long length, const int rowCount) {
+    if (blockCount == blockCapacity) {
+        blockCapacity = blockCapacity ? blockCapacity * 2 : 256;
+        blocks = realloc(blocks, sizeof(MedicineBlock) * blockCapacity);
+    }
+    blocks[blockCount].offset = offset;
+    blocks[blockCount].length = length;
+    blocks[blockCount].rowCount = rowCount;
+    intMapPut(&blockIndex, emergencyId, blockCount);
+    blockCount++;
+
+    if (offset + length > indexedSize) indexedSize = offset + length;
+}
+
+static void writeIndexEntry(FILE* idxFp, const int emergencyId, const long offset, const long length, const int rowCount) {
+    fprintf(idxFp, "%d,%ld,%ld,%d\n", emergencyId, offset, length, rowCount);
+}
+
+static void resetIndex() {
+    clearIntMap(&blockIndex);
+    blockCount = 0;
+    indexedSize = 0;
+}
+
+// Open the index file, starting it with the format header when it is new
+static FILE* openIndexFile(const char* mode) {
+    FILE *idxFp = fopen(EMERGENCY_MEDICINE_INDEXFILE, mode);
+    if (!idxFp) return NULL;
+    fseek(idxFp, 0, SEEK_END);
+    if (ftell(idxFp) == 0) fprintf(idxFp, "blocks,%d,%ld\n", EMERGENCY_MEDICINE_INDEX_VERSION, legacyEnd);
+    return idxFp;
+}
+
+// Group every row past indexedSize into per-visit blocks and persist them.
+// Older builds appended a visit's list again on every save, often right
+// after the previous one, so before legacyEnd the first row of a visit's
+// run coming round again starts a new block. Later lists may repeat a row,
+// so there only a change of visit does.
+static void indexDataFileTail(FILE* dataFp, FILE* idxFp) {
+    fseek(dataFp, indexedSize, SEEK_SET);
+
+    char line[512];
+    char firstRow[512] = "";
+    long rowStart = indexedSize;
+    int currentId = 0, rowCount = 0;
+    long blockStart = rowStart;
+
+    while (fgets(line, sizeof(line), dataFp)) {
+        if (!strchr(line, '\n')) break;     // Partial row still being written
+        const long rowEnd = ftell(dataFp);
+
+        int emergencyId;
+        if (sscanf(line, "%d,", &emergencyId) == 1) {
+            const int isRepeatedList = rowStart < legacyEnd && strcmp(line, firstRow) == 0;
+            if (rowCount > 0 && (emergencyId != currentId || isRepeatedList || rowStart == legacyEnd)) {
+                putBlock(currentId, blockStart, rowStart - blockStart, rowCount);
+                if (idxFp) writeIndexEntry(idxFp, currentId, blockStart, rowStart - blockStart, rowCount);
+                rowCount = 0;
+            }
+            if (rowCount == 0) {
+                currentId = emergencyId;
+                blockStart = rowStart;
+                strcpy(firstRow, line);
+            }
+            rowCount++;
+        }
+        rowStart = rowEnd;
+    }
+
+    if (rowCount > 0) {
+        putBlock(currentId, blockStart, rowStart - blockStart, rowCount);
+        if (idxFp) writeIndexEntry(idxFp, currentId, blockStart, rowStart - blockStart, rowCount);
+    }
+    indexedSize = rowStart;
+}
+
+// Returns 0 if there is no index file in the current format
+static int loadIndexFile() {
+    FILE *idxFp = fopen(EMERGENCY_MEDICINE_INDEXFILE, "r");
+    if (!idxFp) return 0;
+
+    char line[128];
+    int version;
+    if (!fgets(line, sizeof(line), idxFp) || sscanf(line, "blocks,%d,%ld", &version, &legacyEnd) != 2 ||
+        version != EMERGENCY_MEDICINE_INDEX_VERSION) {
+        // Written before repeated blocks were split apart
+        fclose(idxFp);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), idxFp)) {
+        int emergencyId, rowCount;
+        long offset, length;
+        if (sscanf(line, "%d,%ld,%ld,%d", &emergencyId, &offset, &length, &rowCount) == 4) {
+            putBlock(emergencyId, offset, length, rowCount);
+        }
+    }
+    fclose(idxFp);
+    return 1;
+}
+
+// Bring the in-memory and on-disk index up to date with the data file
+static void refreshMedicineIndex() {
+    int isIndexFileCurrent = 1;
+    if (!isIndexLoaded) {
+        isIndexFileCurrent = loadIndexFile();
+        isIndexLoaded = 1;
+    }
+
+    FILE *dataFp = fopen(EMERGENCY_MEDICINE_DATAFILE, "r");
+    if (!dataFp) {
+        resetIndex();
+        return;
+    }
+    fseek(dataFp, 0, SEEK_END);
+    const long dataSize = ftell(dataFp);
+
+    if (dataSize < indexedSize || !isIndexFileCurrent) {
+        // Data file was replaced or truncated, or the index predates the
+        // current format, so start the index over. Without a current index
+        // any rows already there may have been written by an older build.
+        if (!isIndexFileCurrent || dataSize < legacyEnd) legacyEnd = dataSize;
+        resetIndex();
+        FILE *idxFp = openIndexFile("w");
+        indexDataFileTail(dataFp, idxFp);
+        if (idxFp) fclose(idxFp);
+    } else if (dataSize > indexedSize) {
+        FILE *idxFp = openIndexFile("a");
+        indexDataFileTail(dataFp, idxFp);
+        if (idxFp) fclose(idxFp);
+    }
+    fclose(dataFp);
+}
+
+// Returns 0 if the block could not be written
+int appendEmergencyMedicines(const int emergencyId, const EmergencyMedicine* medicines, const int count) {
+    if (count <= 0) return 1;
+    refreshMedicineIndex();
+
+    FILE *medFp = fopen(EMERGENCY_MEDICINE_DATAFILE, "a");
+    if (!medFp) {
+        perror("Unable to open emergency medicine data file");
+        return 0;
+    }
+
+    fseek(medFp, 0, SEEK_END);
+    const long offset = ftell(medFp);
+    for (int i = 0; i < count; i++) {
+        const EmergencyMedicine *med = &medicines[i];
+        fprintf(medFp, "%d,%d,%s,%d,%s,%s\n",
+                emergencyId,
+                med->medicineId,
+                med->medicineName,
+                med->quantity,
+                med->dosage,
+                med->instructions);
+    }
+    const long length = ftell(medFp) - offset;
+    const int isWritten = !ferror(medFp);
+    if (fclose(medFp) != 0 || !isWritten) {
+        perror("Unable to write emergency medicine data file");
+        return 0;
+    }
+
+    // Only index the block directly if nobody else appended in between
+    if (offset != indexedSize) {
+        refreshMedicineIndex();
+        return 1;
+    }
+    putBlock(emergencyId, offset, length, count);
+
+    FILE *idxFp = openIndexFile("a");
+    if (idxFp) {
+        writeIndexEntry(idxFp, emergencyId, offset, length, count);
+        fclose(idxFp);
+    }
+    return 1;
+}
+
+// Load the latest medicine list saved for a visit. Returns the number of
+// medicines read, at most maxMedicines.
+int findEmergencyMedicines(const int emergencyId, EmergencyMedicine* medicines, const int maxMedicines) {
+    refreshMedicineIndex();
+
+    int blockNumber;
+    if (!intMapGet(&blockIndex, emergencyId, &blockNumber)) return 0;
+    const MedicineBlock* block = &blocks[blockNumber];
+
+    FILE *medFp = fopen(EMERGENCY_MEDICINE_DATAFILE, "r");
+    if (!medFp) return 0;
+    fseek(medFp, block->offset, SEEK_SET);
+
+    int count = 0;
+    char line[512];
+    for (int row = 0; row < block->rowCount && count < maxMedicines && fgets(line, sizeof(line), medFp); row++) {
+        EmergencyMedicine* med = &medicines[count];
+        int rowEmergencyId;
+        memset(med, 0, sizeof(*med));
+        // Format: EmergID,MedID,MedName,Qty,Dosage,Instructions
+        if (sscanf(line, "%d,%d,%49[^,],%d,%29[^,],%99[^\n]", &rowEmergencyId, &med->medicineId,
+                   med->medicineName, &med->quantity, med->dosage, med->instructions) >= 4 &&
+            rowEmergencyId == emergencyId) {
+            count++;
+        }
+    }
+    fclose(medFp);
+    return count;
+}
+
+void refreshEmergencyMedicineIndex() {
+    refreshMedicineIndex();
+}
+
+// Locate the latest block for a visit so bulk readers scanning the whole
+// file can skip superseded rows. Callers refresh the index once beforehand.
+// Returns 0 if the visit has no medicines.
+int getEmergencyMedicineBlock(const int emergencyId, long* offset, long* length) {
+    int blockNumber;
+    if (!intMapGet(&blockIndex, emergencyId, &blockNumber)) return 0;
+    *offset = blocks[blockNumber].offset;
+    *length = blocks[blockNumber].length;
+    return 1;
+}
@@ -0,0 +1,880 @@
+#ifndef _WIN32
+#define _XOPEN_SOURCE 700
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include "emergency_queue.h"
+#include "emergency_stats.h"
+#include "dateutil.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define EMERGENCY_SETTINGS_FILE "data/emergency_settings.csv"
+#define EMERGENCY_BOARD_MAGIC 0x45524251U
+#define EMERGENCY_BOARD_WAIT_MS 5000
+
+static EmergencyBoard* board = NULL;
+static int mappedCapacity = 0;
+static int isQueueInitialized = 0;
+
+#ifndef _WIN32
+static int boardFd = -1;
+static char boardName[64];
+static EmergencyBoard* lockedBoard = NULL;  // Mapping the held lock was taken through
+static int lockedCapacity = 0;
+#endif
+
+static size_t getBoardSize(const int capacity) {
+    return offsetof(EmergencyBoard, slots) + sizeof(EmergencyBoardSlot) * (size_t)capacity;
+}
+
+static EmergencyQueueEntry* heapAt(const int position) {
+    return &board->slots[position].heapEntry;
+}
+
+static void loadEmergencyQueueSettings() {
+    FILE *fp = fopen(EMERGENCY_SETTINGS_FILE, "r");
+    if (!fp) return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+        char key[64];
+        int value;
+        if (sscanf(line, "%63[^,],%d", key, &value) != 2) continue;
+        if (strcmp(key, "agingMinutes") == 0 && value >= 0) {
+            board->agingMinutes = value;
+        }
+    }
+    fclose(fp);
+}
+
+static void saveEmergencyQueueSettings(const int agingMinutes) {
+    FILE *fp = fopen(EMERGENCY_SETTINGS_FILE, "w");
+    if (!fp) {
+        perror("Unable to save emergency settings");
+        return;
+    }
+    fprintf(fp, "agingMinutes,%d\n", agingMinutes);
+    fclose(fp);
+}
+
+// Free list and hash buckets for slots [from, capacity)
+static void initializeBoardSlots(const int from) {
+    for (int i = board->capacity - 1; i >= from; i--) {
+        EmergencyBoardSlot* slot = &board->slots[i];
+        slot->inUse = 0;
+        slot->heapPosition = -1;
+        slot->nextInBucket = -1;
+        slot->bucketHead = -1;
+        slot->nextFree = board->firstFree;
+        board->firstFree = i;
+    }
+}
+
+static void initializeBoard(const int capacity) {
+    memset(board, 0, getBoardSize(capacity));
+    board->magic = EMERGENCY_BOARD_MAGIC;
+    board->slotSize = sizeof(EmergencyBoardSlot);
+    board->capacity = capacity;
+    board->firstFree = -1;
+    board->agingMinutes = DEFAULT_EMERGENCY_AGING_MINUTES;
+    board->lastEmergencyId = FIRST_EMERGENCY_ID - 1;
+    board->nextTempPatientId = -1;
+    initializeBoardSlots(0);
+}
+
+#ifndef _WIN32
+// Map the board at a new size. Other terminals may have grown it. The
+// mapping a held lock was taken through stays mapped until it is released,
+// so the lock's robust-list entry never points at unmapped memory.
+static int remapBoard(const int capacity) {
+    void* mapped = mmap(NULL, getBoardSize(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, boardFd, 0);
+    if (mapped == MAP_FAILED) return 0;
+
+    if (board && board != lockedBoard) munmap(board, getBoardSize(mappedCapacity));
+    board = mapped;
+    mappedCapacity = capacity;
+    return 1;
+}
+
+static void acquireBoardLock() {
+    lockedBoard = board;
+    lockedCapacity = mappedCapacity;
+    if (pthread_mutex_lock(&lockedBoard->lock) == EOWNERDEAD) {
+        pthread_mutex_consistent(&lockedBoard->lock);
+    }
+}
+
+// Unlock through the mapping the lock was taken through, then drop that
+// mapping if the board has been remapped since
+static void releaseBoardLock() {
+    EmergencyBoard* locked = lockedBoard;
+    lockedBoard = NULL;
+    pthread_mutex_unlock(&locked->lock);
+    if (locked != board) munmap(locked, getBoardSize(lockedCapacity));
+}
+
+static void detachEmergencyBoard() {
+    if (!board || boardFd < 0) return;
+
+    pthread_mutex_lock(&board->lock);
+    board->attachCount--;
+    if (board->attachCount <= 0) {
+        // Last terminal out: the next one rebuilds the queue from disk
+        board->retired = 1;
+        shm_unlink(boardName);
+    }
+    pthread_mutex_unlock(&board->lock);
+
+    munmap(board, getBoardSize(mappedCapacity));
+    close(boardFd);
+    board = NULL;
+    boardFd = -1;
+}
+
+// One board per data directory, so separate installs never share a queue
+static void buildBoardName() {
+    char* dataPath = realpath("data", NULL);
+    const char* key = dataPath ? dataPath : "data";
+
+    unsigned int hash = 2166136261U;
+    for (const char* c = key; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619U;
+    }
+    snprintf(boardName, sizeof(boardName), "/smrms_emergency_%08x", hash);
+    free(dataPath);
+}
+
+static int createSharedBoard() {
+    boardFd = shm_open(boardName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (boardFd < 0) return 0;
+
+    if (ftruncate(boardFd, (off_t)getBoardSize(EMERGENCY_BOARD_INITIAL_SLOTS)) != 0 ||
+        !remapBoard(EMERGENCY_BOARD_INITIAL_SLOTS)) {
+        close(boardFd);
+        shm_unlink(boardName);
+        boardFd = -1;
+        return 0;
+    }
+    initializeBoard(EMERGENCY_BOARD_INITIAL_SLOTS);
+
+    // Robust, so a terminal that dies mid-update cannot wedge the others
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&board->lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+
+    board->attachCount = 1;
+    return 1;
+}
+
+static void sleepMilliseconds(const long milliseconds) {
+    const struct timespec delay = { milliseconds / 1000, (milliseconds % 1000) * 1000000L };
+    nanosleep(&delay, NULL);
+}
+
+// Returns 1 once attached, 0 if the existing board is unusable and was
+// unlinked (the caller should try to create a fresh one), -1 on error.
+static int attachSharedBoard() {
+    boardFd = shm_open(boardName, O_RDWR, 0600);
+    if (boardFd < 0) return errno == ENOENT ? 0 : -1;
+
+    // Wait for the creating terminal to finish recovering the queue
+    struct stat info = {0};
+    int waited = 0;
+    while (fstat(boardFd, &info) == 0 && (size_t)info.st_size < getBoardSize(EMERGENCY_BOARD_INITIAL_SLOTS) &&
+           waited < EMERGENCY_BOARD_WAIT_MS) {
+        sleepMilliseconds(10);
+        waited += 10;
+    }
+    if ((size_t)info.st_size >= getBoardSize(EMERGENCY_BOARD_INITIAL_SLOTS) &&
+        remapBoard(EMERGENCY_BOARD_INITIAL_SLOTS)) {
+        while (!__atomic_load_n(&board->ready, __ATOMIC_ACQUIRE) && waited < EMERGENCY_BOARD_WAIT_MS) {
+            sleepMilliseconds(10);
+            waited += 10;
+        }
+    }
+
+    if (!board || board->magic != EMERGENCY_BOARD_MAGIC || board->slotSize != sizeof(EmergencyBoardSlot) ||
+        !__atomic_load_n(&board->ready, __ATOMIC_ACQUIRE)) {
+        // Left by a crashed creator or an incompatible build
+        if (board) munmap(board, getBoardSize(mappedCapacity));
+        board = NULL;
+        close(boardFd);
+        boardFd = -1;
+        shm_unlink(boardName);
+        return 0;
+    }
+
+    acquireBoardLock();
+    const int isRetired = board->retired;
+    const int isMapped = isRetired || board->capacity == mappedCapacity || remapBoard(board->capacity);
+    if (isRetired || !isMapped) {
+        // The last terminal left while we were opening it, or the board
+        // has grown past what can be mapped here
+        if (!isMapped) perror("Unable to map the emergency queue");
+        releaseBoardLock();
+        munmap(board, getBoardSize(mappedCapacity));
+        board = NULL;
+        close(boardFd);
+        boardFd = -1;
+        return isRetired ? 0 : -1;
+    }
+    board->attachCount++;
+    releaseBoardLock();
+    return 1;
+}
+#endif
+
+static int createPrivateBoard() {
+    board = malloc(getBoardSize(EMERGENCY_BOARD_INITIAL_SLOTS));
+    if (!board) return 0;
+    mappedCapacity = EMERGENCY_BOARD_INITIAL_SLOTS;
+    initializeBoard(EMERGENCY_BOARD_INITIAL_SLOTS);
+    return 1;
+}
+
+// Attach to the live queue. Returns 1 if this process created the board
+// and must fill it (then call publishEmergencyQueue), 0 if it joined a
+// queue another terminal already holds.
+int initializeEmergencyQueue() {
+    if (isQueueInitialized) return 0;
+    isQueueInitialized = 1;
+
+#ifndef _WIN32
+    buildBoardName();
+    for (int attempt = 0; attempt < 3; attempt++) {
+        if (createSharedBoard()) {
+            loadEmergencyQueueSettings();
+            atexit(detachEmergencyBoard);
+            return 1;
+        }
+        if (errno != EEXIST) break;
+
+        const int attached = attachSharedBoard();
+        if (attached > 0) {
+            atexit(detachEmergencyBoard);
+            return 0;
+        }
+        if (attached < 0) break;
+    }
+    printf("Shared emergency queue unavailable; this terminal keeps its own queue.\n");
+#endif
+
+    if (!createPrivateBoard()) {
+        perror("Unable to allocate emergency queue");
+        exit(1);
+    }
+    loadEmergencyQueueSettings();
+    return 1;
+}
+
+// Lock the board for work on the header fields only, which sit at the
+// same place in every mapping however far the board has grown
+static void lockBoardHeader() {
+#ifndef _WIN32
+    if (boardFd >= 0) acquireBoardLock();
+#endif
+}
+
+// Lock the board and map every slot another terminal may have added.
+// Returns 0, with the lock released, if the grown board cannot be mapped.
+static int lockBoard() {
+#ifndef _WIN32
+    if (boardFd < 0) return 1;
+    acquireBoardLock();
+    if (board->capacity != mappedCapacity && !remapBoard(board->capacity)) {
+        perror("Unable to map the emergency queue");
+        releaseBoardLock();
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+static void unlockBoard() {
+#ifndef _WIN32
+    if (boardFd >= 0) releaseBoardLock();
+#endif
+}
+
+// Let other terminals attach once the creator has recovered the queue
+void publishEmergencyQueue() {
+#ifndef _WIN32
+    if (boardFd >= 0) __atomic_store_n(&board->ready, 1, __ATOMIC_RELEASE);
+#endif
+}
+
+int isEmergencyQueueShared() {
+#ifndef _WIN32
+    return boardFd >= 0;
+#else
+    return 0;
+#endif
+}
+
+int getEmergencyQueueCount() {
+    lockBoardHeader();
+    const int count = board->count;
+    unlockBoard();
+    return count;
+}
+
+int isEmergencyQueueEmpty() {
+    return getEmergencyQueueCount() == 0;
+}
+
+// Patients held on the board, waiting or in treatment
+int getEmergencyBoardCount() {
+    if (!lockBoard()) return 0;
+    int held = 0;
+    for (int i = 0; i < board->capacity; i++) {
+        held += board->slots[i].inUse != 0;
+    }
+    unlockBoard();
+    return held;
+}
+
+static int getBucket(const int emergencyId) {
+    return (int)((unsigned int)emergencyId % (unsigned int)board->capacity);
+}
+
+static int findSlotById(const int emergencyId) {
+    for (int i = board->slots[getBucket(emergencyId)].bucketHead; i >= 0; i = board->slots[i].nextInBucket) {
+        if (board->slots[i].patient.emergencyId == emergencyId) return i;
+    }
+    return -1;
+}
+
+static void linkSlotById(const int slot) {
+    EmergencyBoardSlot* bucket = &board->slots[getBucket(board->slots[slot].patient.emergencyId)];
+    board->slots[slot].nextInBucket = bucket->bucketHead;
+    bucket->bucketHead = slot;
+}
+
+static void unlinkSlotById(const int slot) {
+    int* link = &board->slots[getBucket(board->slots[slot].patient.emergencyId)].bucketHead;
+    while (*link >= 0 && *link != slot) {
+        link = &board->slots[*link].nextInBucket;
+    }
+    if (*link == slot) *link = board->slots[slot].nextInBucket;
+}
+
+// Double the board. Caller holds the lock. Returns 0 if out of memory.
+static int growBoard() {
+    const int oldCapacity = board->capacity;
+    const int newCapacity = oldCapacity * 2;
+
+#ifndef _WIN32
+    if (boardFd >= 0) {
+        if (ftruncate(boardFd, (off_t)getBoardSize(newCapacity)) != 0 || !remapBoard(newCapacity)) return 0;
+    } else
+#endif
+    {
+        EmergencyBoard* grown = realloc(board, getBoardSize(newCapacity));
+        if (!grown) return 0;
+        board = grown;
+        mappedCapacity = newCapacity;
+    }
+
+    board->capacity = newCapacity;
+    initializeBoardSlots(oldCapacity);
+
+    // Bucket count follows capacity, so rehash every held record
+    for (int i = 0; i < newCapacity; i++) {
+        board->slots[i].bucketHead = -1;
+    }
+    for (int i = 0; i < oldCapacity; i++) {
+        if (board->slots[i].inUse) linkSlotById(i);
+    }
+    return 1;
+}
+
+static int allocateSlot() {
+    if (board->firstFree < 0 && !growBoard()) return -1;
+
+    const int slot = board->firstFree;
+    board->firstFree = board->slots[slot].nextFree;
+    board->slots[slot].inUse = 1;
+    board->slots[slot].heapPosition = -1;
+    board->slots[slot].nextInBucket = -1;
+    return slot;
+}
+
+static void freeSlot(const int slot) {
+    unlinkSlotById(slot);
+    board->slots[slot].inUse = 0;
+    board->slots[slot].nextFree = board->firstFree;
+    board->firstFree = slot;
+}
+
+// Negative if a should be treated before b
+static int compareQueueEntries(const EmergencyQueueEntry* a, const EmergencyQueueEntry* b) {
+    if (a->priority != b->priority) return a->priority < b->priority ? -1 : 1;
+    if (a->sequence != b->sequence) return a->sequence < b->sequence ? -1 : 1;
+    return 0;
+}
+
+static void placeQueueEntry(const int position, const EmergencyQueueEntry entry) {
+    *heapAt(position) = entry;
+    board->slots[entry.slot].heapPosition = position;
+}
+
+static void siftQueueEntryUp(int position) {
+    const EmergencyQueueEntry moving = *heapAt(position);
+
+    while (position > 0) {
+        const int parent = (position - 1) / 2;
+        if (compareQueueEntries(&moving, heapAt(parent)) >= 0) break;
+        placeQueueEntry(position, *heapAt(parent));
+        position = parent;
+    }
+    placeQueueEntry(position, moving);
+}
+
+static void siftQueueEntryDown(int position) {
+    const EmergencyQueueEntry moving = *heapAt(position);
+
+    while (1) {
+        const int left = position * 2 + 1;
+        if (left >= board->count) break;
+
+        int child = left;
+        if (left + 1 < board->count && compareQueueEntries(heapAt(left + 1), heapAt(left)) < 0) {
+            child = left + 1;
+        }
+        if (compareQueueEntries(heapAt(child), &moving) >= 0) break;
+
+        placeQueueEntry(position, *heapAt(child));
+        position = child;
+    }
+    placeQueueEntry(position, moving);
+}
+
+// Take the entry at `position` out of the heap
+static void removeQueueEntry(const int position) {
+    board->slots[heapAt(position)->slot].heapPosition = -1;
+
+    board->count--;
+    if (position == board->count) return;
+
+    // The moved-in last entry may belong above or below this position
+    const EmergencyQueueEntry last = *heapAt(board->count);
+    placeQueueEntry(position, last);
+    siftQueueEntryUp(position);
+    if (heapAt(position)->slot == last.slot) {
+        siftQueueEntryDown(position);
+    }
+}
+
+// Arrival as a timestamp; falls back to `fallback` if the fields do not parse
+static time_t parseArrivalEpoch(const EmergencyPatient* patient, const time_t fallback) {
+    const time_t epoch = parseDateTime(patient->arrivalDate, patient->arrivalTime);
+    return epoch == (time_t)-1 ? fallback : epoch;
+}
+
+// Triage priority improved by one level per full aging interval waited.
+// Sets *nextDue to when the next promotion happens, or 0 if it never will.
+static EmergencyPriority computeEffectivePriority(const EmergencyPatient* patient, const time_t now, time_t* nextDue) {
+    *nextDue = 0;
+    if (board->agingMinutes <= 0 || patient->priority <= CRITICAL ||
+        strcmp(patient->status, "Waiting") != 0) {
+        return patient->priority;
+    }
+
+    const time_t interval = (time_t)board->agingMinutes * 60;
+    const time_t waited = now > patient->arrivalEpoch ? now - patient->arrivalEpoch : 0;
+    const long steps = (long)(waited / interval);
+
+    if (steps >= (long)patient->priority - CRITICAL) return CRITICAL;
+
+    *nextDue = patient->arrivalEpoch + (steps + 1) * interval;
+    return (EmergencyPriority)(patient->priority - steps);
+}
+
+static void noteAgingDue(const time_t due) {
+    if (due != 0 && (board->nextAgingDue == 0 || due < board->nextAgingDue)) {
+        board->nextAgingDue = due;
+    }
+}
+
+// Move the entry at `position` to a new key and restore heap order
+static void rekeyQueueEntry(const int position, const EmergencyPriority priority) {
+    const int oldPriority = heapAt(position)->priority;
+    heapAt(position)->priority = priority;
+
+    if ((int)priority < oldPriority) {
+        siftQueueEntryUp(position);
+    } else if ((int)priority > oldPriority) {
+        siftQueueEntryDown(position);
+    }
+}
+
+// Promote waiting patients whose wait crossed an aging boundary. Does
+// nothing until the earliest pending promotion is due; each promotion is a
+// decrease-key on the heap, so the queue is never re-sorted.
+static void ageEmergencyQueue(const time_t now) {
+    if (board->nextAgingDue == 0 || now < board->nextAgingDue) return;
+
+    board->nextAgingDue = 0;
+    // A sift-up only moves already visited ancestors down, so one pass suffices
+    for (int i = 0; i < board->count; i++) {
+        EmergencyPatient* patient = &board->slots[heapAt(i)->slot].patient;
+        time_t due;
+        const EmergencyPriority effective = computeEffectivePriority(patient, now, &due);
+        noteAgingDue(due);
+
+        if ((int)effective < heapAt(i)->priority) {
+            patient->effectivePriority = effective;
+            rekeyQueueEntry(i, effective);
+        }
+    }
+}
+
+int getEmergencyAgingInterval() {
+    lockBoardHeader();
+    const int minutes = board->agingMinutes;
+    unlockBoard();
+    return minutes;
+}
+
+// Change the aging interval and re-key every queued patient under it.
+// Returns 0 if the board could not be locked.
+int setEmergencyAgingInterval(const int minutes) {
+    const time_t now = time(NULL);
+
+    if (!lockBoard()) return 0;
+    board->agingMinutes = minutes > 0 ? minutes : 0;
+    board->nextAgingDue = 0;
+    for (int i = 0; i < board->count; i++) {
+        EmergencyPatient* patient = &board->slots[heapAt(i)->slot].patient;
+        time_t due;
+        patient->effectivePriority = computeEffectivePriority(patient, now, &due);
+        heapAt(i)->priority = patient->effectivePriority;
+        noteAgingDue(due);
+    }
+    for (int i = board->count / 2 - 1; i >= 0; i--) {
+        siftQueueEntryDown(i);
+    }
+    const int savedMinutes = board->agingMinutes;
+    unlockBoard();
+
+    saveEmergencyQueueSettings(savedMinutes);
+    return 1;
+}
+
+// Copy a patient onto the board, reusing their slot if already held, and
+// work out their aged priority. Caller holds the lock.
+// Returns the slot, or -1 if the board could not grow.
+static int storeEmergencyPatient(const EmergencyPatient* patient, const time_t now) {
+    int slot = findSlotById(patient->emergencyId);
+    if (slot < 0) {
+        slot = allocateSlot();
+        if (slot < 0) return -1;
+        board->slots[slot].patient.emergencyId = patient->emergencyId;
+        linkSlotById(slot);
+    }
+
+    EmergencyBoardSlot* record = &board->slots[slot];
+    const unsigned int sequence = record->heapPosition >= 0 ? record->patient.arrivalSequence : board->nextSequence++;
+    record->patient = *patient;
+    record->patient.arrivalSequence = sequence;
+    record->patient.arrivalEpoch = parseArrivalEpoch(patient, now);
+
+    time_t due;
+    record->patient.effectivePriority = computeEffectivePriority(&record->patient, now, &due);
+    noteAgingDue(due);
+    return slot;
+}
+
+static int isWaiting(const EmergencyPatient* patient) {
+    return strcmp(patient->status, "Waiting") == 0;
+}
+
+// Only waiting patients are queued. A stored record that is no longer
+// waiting leaves the heap but stays on the board. Caller holds the lock.
+static void requeueStoredPatient(const int slot) {
+    const EmergencyBoardSlot* record = &board->slots[slot];
+    if (record->heapPosition < 0) return;
+
+    if (isWaiting(&record->patient)) {
+        rekeyQueueEntry(record->heapPosition, record->patient.effectivePriority);
+    } else {
+        removeQueueEntry(record->heapPosition);
+    }
+}
+
+// Store a patient and queue them if they are waiting. A patient already on
+// the board is updated in place: if still queued they keep their place in
+// line, if returned to waiting they go behind patients of the same priority.
+// Returns 0 if the board could not grow.
+int enqueueEmergencyPatient(const EmergencyPatient* patient) {
+    if (!lockBoard()) return 0;
+    const int slot = storeEmergencyPatient(patient, time(NULL));
+    if (slot < 0) {
+        unlockBoard();
+        return 0;
+    }
+
+    const EmergencyBoardSlot* record = &board->slots[slot];
+    if (record->heapPosition >= 0 || !isWaiting(&record->patient)) {
+        requeueStoredPatient(slot);
+    } else {
+        // Heap entries never outnumber slots, so there is always room
+        const EmergencyQueueEntry entry = { record->patient.effectivePriority, record->patient.arrivalSequence, slot };
+        const int position = board->count++;
+        placeQueueEntry(position, entry);
+        siftQueueEntryUp(position);
+    }
+    unlockBoard();
+    return 1;
+}
+
+// Save changes to a patient held on the board, e.g. after treatment,
+// without putting them in line. A patient in treatment stays off the queue.
+// Returns 0 if the board could not grow.
+int updateEmergencyPatient(const EmergencyPatient* patient) {
+    if (!lockBoard()) return 0;
+    const int slot = storeEmergencyPatient(patient, time(NULL));
+    if (slot >= 0) requeueStoredPatient(slot);
+    unlockBoard();
+    return slot >= 0;
+}
+
+// Queue many patients under one lock, e.g. a mass-casualty intake. New
+// entries are appended unordered, then heap order is restored either by
+// sifting each one up, O(k log n), or, when the batch is a large share of
+// the queue, by rebuilding the heap bottom-up in O(n).
+// Patients not waiting are stored without being queued.
+// Returns how many patients were stored before the board ran out of memory.
+int enqueueEmergencyPatients(const EmergencyPatient* patients, const int count) {
+    const time_t now = time(NULL);
+
+    if (!lockBoard()) return 0;
+    const int firstAppended = board->count;
+    int queued = 0, isRekeyed = 0;
+    for (; queued < count; queued++) {
+        const int slot = storeEmergencyPatient(&patients[queued], now);
+        if (slot < 0) break;
+
+        const EmergencyBoardSlot* record = &board->slots[slot];
+        if (record->heapPosition >= 0) {
+            // Either way the whole heap is rebuilt below
+            if (isWaiting(&record->patient)) {
+                heapAt(record->heapPosition)->priority = record->patient.effectivePriority;
+            } else {
+                removeQueueEntry(record->heapPosition);
+            }
+            isRekeyed = 1;
+        } else if (isWaiting(&record->patient)) {
+            const EmergencyQueueEntry entry = { record->patient.effectivePriority, record->patient.arrivalSequence, slot };
+            placeQueueEntry(board->count++, entry);
+        }
+    }
+
+    const int appended = board->count - firstAppended;
+    if (isRekeyed || appended * 4 >= board->count) {
+        for (int position = board->count / 2 - 1; position >= 0; position--) {
+            siftQueueEntryDown(position);
+        }
+    } else {
+        for (int position = firstAppended; position < board->count; position++) {
+            siftQueueEntryUp(position);
+        }
+    }
+    unlockBoard();
+    return queued;
+}
+
+// Mark a record In Treatment. Returns 1 the first time the patient is
+// treated, which is when their wait for treatment is measured.
+static int startTreatment(EmergencyPatient* patient) {
+    strcpy(patient->status, "In Treatment");
+    if (patient->treatmentStartEpoch != 0) return 0;
+    patient->treatmentStartEpoch = time(NULL);
+    return 1;
+}
+
+// Atomically take the most urgent waiting patient off the queue and mark
+// them In Treatment, so two terminals can never claim the same patient. The
+// record stays on the board, out of the queue, until it is removed.
+// Returns 0 if nobody is waiting.
+int claimNextEmergencyPatient(EmergencyPatient* patient) {
+    if (!lockBoard()) return 0;
+    ageEmergencyQueue(time(NULL));
+
+    // Only waiting patients are queued; anything else is dropped, not claimed
+    while (board->count > 0 && !isWaiting(&board->slots[heapAt(0)->slot].patient)) {
+        removeQueueEntry(0);
+    }
+    if (board->count == 0) {
+        unlockBoard();
+        return 0;
+    }
+
+    EmergencyBoardSlot* record = &board->slots[heapAt(0)->slot];
+    removeQueueEntry(0);
+    const int firstTreatment = startTreatment(&record->patient);
+    *patient = record->patient;
+    unlockBoard();
+
+    if (firstTreatment) recordEmergencyTreatmentStart(patient);
+    return 1;
+}
+
+// Claim one particular waiting patient for `doctor`, as claimNextEmergencyPatient
+// does for the head of the queue. Returns 0 if they are no longer waiting.
+int claimEmergencyPatient(const int emergencyId, const char* doctor, EmergencyPatient* patient) {
+    if (!lockBoard()) return 0;
+    const int slot = findSlotById(emergencyId);
+    if (slot < 0 || board->slots[slot].heapPosition < 0 || !isWaiting(&board->slots[slot].patient)) {
+        unlockBoard();
+        return 0;
+    }
+
+    EmergencyBoardSlot* record = &board->slots[slot];
+    removeQueueEntry(record->heapPosition);
+    const int firstTreatment = startTreatment(&record->patient);
+    strncpy(record->patient.treatingDoctor, doctor, sizeof(record->patient.treatingDoctor) - 1);
+    record->patient.treatingDoctor[sizeof(record->patient.treatingDoctor) - 1] = '\0';
+    *patient = record->patient;
+    unlockBoard();
+
+    if (firstTreatment) recordEmergencyTreatmentStart(patient);
+    return 1;
+}
+
+// Copy out any patient held on the board, queued or in treatment.
+// `patient` may be NULL to only test for presence.
+int findEmergencyPatient(const int emergencyId, EmergencyPatient* patient) {
+    if (!lockBoard()) return 0;
+    const int slot = findSlotById(emergencyId);
+    if (slot >= 0 && patient) *patient = board->slots[slot].patient;
+    unlockBoard();
+    return slot >= 0;
+}
+
+// Drop a patient from the board, e.g. on discharge.
+// Returns 0 if no record is held for that emergencyId.
+int removeEmergencyPatient(const int emergencyId) {
+    if (!lockBoard()) return 0;
+    const int slot = findSlotById(emergencyId);
+    if (slot >= 0) {
+        if (board->slots[slot].heapPosition >= 0) {
+            removeQueueEntry(board->slots[slot].heapPosition);
+        }
+        freeSlot(slot);
+    }
+    unlockBoard();
+    return slot >= 0;
+}
+
+// Re-triage a queued patient in place and copy out the updated record.
+// Time already waited still counts toward aging. Returns 0 if they are not queued.
+int changeEmergencyPriority(const int emergencyId, const EmergencyPriority priority, EmergencyPatient* patient) {
+    if (!lockBoard()) return 0;
+    const int slot = findSlotById(emergencyId);
+    if (slot < 0 || board->slots[slot].heapPosition < 0) {
+        unlockBoard();
+        return 0;
+    }
+
+    EmergencyBoardSlot* record = &board->slots[slot];
+    time_t due;
+    record->patient.priority = priority;
+    record->patient.effectivePriority = computeEffectivePriority(&record->patient, time(NULL), &due);
+    noteAgingDue(due);
+    rekeyQueueEntry(record->heapPosition, record->patient.effectivePriority);
+    if (patient) *patient = record->patient;
+    unlockBoard();
+    return 1;
+}
+
+static int compareQueueEntriesQsort(const void* a, const void* b) {
+    return compareQueueEntries(a, b);
+}
+
+// Snapshot of the queue in treatment order. The caller frees the result,
+// which is NULL if the board could not be locked.
+EmergencyPatient* copyEmergencyQueue(int* count) {
+    if (!lockBoard()) {
+        *count = 0;
+        return NULL;
+    }
+    ageEmergencyQueue(time(NULL));
+
+    const int queued = board->count;
+    EmergencyQueueEntry* entries = malloc(sizeof(EmergencyQueueEntry) * (queued > 0 ? queued : 1));
+    EmergencyPatient* patients = malloc(sizeof(EmergencyPatient) * (queued > 0 ? queued : 1));
+    for (int i = 0; i < queued; i++) {
+        entries[i] = *heapAt(i);
+    }
+    qsort(entries, queued, sizeof(EmergencyQueueEntry), compareQueueEntriesQsort);
+    for (int i = 0; i < queued; i++) {
+        patients[i] = board->slots[entries[i].slot].patient;
+    }
+    unlockBoard();
+
+    free(entries);
+    *count = queued;
+    return patients;
+}
+
+// Every patient held on the board, queued or in treatment, in no particular
+// order. The caller frees the result, NULL if the board could not be locked.
+EmergencyPatient* copyEmergencyBoard(int* count) {
+    if (!lockBoard()) {
+        *count = 0;
+        return NULL;
+    }
+    ageEmergencyQueue(time(NULL));
+    EmergencyPatient* patients = malloc(sizeof(EmergencyPatient) * (board->capacity > 0 ? board->capacity : 1));
+    int held = 0;
+    for (int i = 0; i < board->capacity; i++) {
+        if (board->slots[i].inUse) patients[held++] = board->slots[i].patient;
+    }
+    unlockBoard();
+
+    *count = held;
+    return patients;
+}
+
+int takeNextEmergencyId() {
+    lockBoardHeader();
+    const int emergencyId = ++board->lastEmergencyId;
+    unlockBoard();
+    return emergencyId;
+}
+
+int takeNextTempPatientId() {
+    lockBoardHeader();
+    const int patientId = board->nextTempPatientId--;
+    unlockBoard();
+    return patientId;
+}
+
+// Make sure IDs handed out from now on are past everything already on disk
+void raiseEmergencyIdFloor(const int maxEmergencyId, const int nextTempPatientId) {
+    lockBoardHeader();
+    if (maxEmergencyId > board->lastEmergencyId) board->lastEmergencyId = maxEmergencyId;
+    if (nextTempPatientId < board->nextTempPatientId) board->nextTempPatientId = nextTempPatientId;
+    unlockBoard();
+}
+
+void getEmergencyIdCounters(int* maxEmergencyId, int* nextTempPatientId) {
+    lockBoardHeader();
+    *maxEmergencyId = board->lastEmergencyId;
+    *nextTempPatientId = board->nextTempPatientId;
+    unlockBoard();
+}
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emergency_records.h"
+#include "hashmap.h"
+
+#define EMERGENCY_DATAFILE "data/emergency.csv"
+#define EMERGENCY_RECORD_INDEXFILE "data/emergency.idx"
+#define EMERGENCY_TEMP_DATAFILE "data/emergency_temp.csv"
+#define EMERGENCY_TEMP_INDEXFILE "data/emergency_temp.idx"
+#define EMERGENCY_ROW_SIZE 1024
+
+static long* latestOffsets = NULL;  // Latest row of each indexed visit
+static int visitCount = 0;
+static int visitCapacity = 0;
+static IntMap visitIndex;           // emergencyId -> latestOffsets slot
+static int staleRowCount = 0;       // Superseded rows still in the data file
+static long indexedSize = 0;        // Bytes of the data file covered by the index
+static int isIndexLoaded = 0;
+
+// Terminals sharing the data directory may index the same rows and append
+// index entries out of order, so the highest offset for a visit wins
+static void putRecordOffset(const int emergencyId, const long offset, const long length) {
+    if (offset + length > indexedSize) indexedSize = offset + length;
+
+    int slot;
+    if (intMapGet(&visitIndex, emergencyId, &slot)) {
+        if (offset != latestOffsets[slot]) staleRowCount++;
+        if (offset > latestOffsets[slot]) latestOffsets[slot] = offset;
+        return;
+    }
+
+    if (visitCount == visitCapacity) {
+        visitCapacity = visitCapacity ? visitCapacity * 2 : 256;
+        latestOffsets = realloc(latestOffsets, sizeof(long) * visitCapacity);
+    }
+    latestOffsets[visitCount] = offset;
+    intMapPut(&visitIndex, emergencyId, visitCount);
+    visitCount++;
+}
+
+static void resetIndex() {
+    clearIntMap(&visitIndex);
+    visitCount = 0;
+    staleRowCount = 0;
+    indexedSize = 0;
+}
+
+// Index every complete row past indexedSize and persist the entries
+static void indexDataFileTail(FILE* dataFp, FILE* idxFp) {
+    fseek(dataFp, indexedSize, SEEK_SET);
+
+    char line[EMERGENCY_ROW_SIZE];
+    long rowStart = indexedSize;
+    while (fgets(line, sizeof(line), dataFp)) {
+        if (!strchr(line, '\n')) break;     // Partial row still being written
+        const long rowEnd = ftell(dataFp);
+
+        int emergencyId;
+        if (sscanf(line, "%d,", &emergencyId) == 1) {
+            putRecordOffset(emergencyId, rowStart, rowEnd - rowStart);
+            if (idxFp) fprintf(idxFp, "%d,%ld,%ld\n", emergencyId, rowStart, rowEnd - rowStart);
+        }
+        rowStart = rowEnd;
+    }
+    if (rowStart > indexedSize) indexedSize = rowStart;
+}
+
+static void loadIndexFile() {
+    FILE *idxFp = fopen(EMERGENCY_RECORD_INDEXFILE, "r");
+    if (!idxFp) return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), idxFp)) {
+        int emergencyId;
+        long offset, length;
+        if (sscanf(line, "%d,%ld,%ld", &emergencyId, &offset, &length) == 3) {
+            putRecordOffset(emergencyId, offset, length);
+        }
+    }
+    fclose(idxFp);
+}
+
+// Bring the in-memory and on-disk index up to date with the data file
+void refreshEmergencyRecordIndex() {
+    if (!isIndexLoaded) {
+        loadIndexFile();
+        isIndexLoaded = 1;
+    }
+
+    FILE *dataFp = fopen(EMERGENCY_DATAFILE, "r");
+    if (!dataFp) {
+        resetIndex();
+        return;
+    }
+    fseek(dataFp, 0, SEEK_END);
+    const long dataSize = ftell(dataFp);
+
+    if (dataSize < indexedSize) {
+        // Data file was replaced or truncated, so start the index over
+        resetIndex();
+        FILE *idxFp = fopen(EMERGENCY_RECORD_INDEXFILE, "w");
+        indexDataFileTail(dataFp, idxFp);
+        if (idxFp) fclose(idxFp);
+    } else if (dataSize > indexedSize) {
+        FILE *idxFp = fopen(EMERGENCY_RECORD_INDEXFILE, "a");
+        indexDataFileTail(dataFp, idxFp);
+        if (idxFp) fclose(idxFp);
+    }
+    fclose(dataFp);
+}
+
+// Format one row into `row`, always ending it with a newline. Returns its length.
+static int formatEmergencyRow(char* row, const int size, const EmergencyPatient* patient) {
+    int length = snprintf(row, size, "%d,%d,%s,%s,%s,%d,%s,%s,%s,%s,%s,%s,%s\n",
+                          patient->emergencyId, patient->patientId, patient->patientName,
+                          patient->patientPhone, patient->symptoms, patient->priority,
+                          patient->arrivalDate, patient->arrivalTime, patient->status,
+                          patient->treatingDoctor, patient->treatment, patient->dischargeTime,
+                          patient->notes);
+    if (length >= size) {
+        length = size - 1;
+        row[length - 1] = '\n';
+    }
+    return length;
+}
+
+// Append new versions of `count` visits with a single write, so a whole
+// intake batch costs one I/O. Returns 0 if the data file could not be written.
+int appendEmergencyRecords(const EmergencyPatient* patients, const int count) {
+    if (count <= 0) return 1;
+    refreshEmergencyRecordIndex();
+
+    char* rows = malloc((size_t)count * EMERGENCY_ROW_SIZE);
+    int* rowEnds = malloc(sizeof(int) * count);
+    if (!rows || !rowEnds) {
+        free(rows);
+        free(rowEnds);
+        return 0;
+    }
+
+    int length = 0;
+    for (int i = 0; i < count; i++) {
+        length += formatEmergencyRow(rows + length, EMERGENCY_ROW_SIZE, &patients[i]);
+        rowEnds[i] = length;
+    }
+
+    FILE *fp = fopen(EMERGENCY_DATAFILE, "a");
+    if (!fp) {
+        perror("Unable to open emergency data file");
+        free(rows);
+        free(rowEnds);
+        return 0;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    const long baseOffset = ftell(fp);
+    const int isWritten = fwrite(rows, 1, length, fp) == (size_t)length;
+    if (isWritten) {
+        for (int i = 0; i < count; i++) {
+            const long rowOffset = baseOffset + (i > 0 ? rowEnds[i - 1] : 0);
+            noteRowAppended(getEmergencyPatientIndex(), patients[i].patientId, rowOffset, baseOffset + rowEnds[i]);
+        }
+    }
+    fclose(fp);
+    free(rows);
+    free(rowEnds);
+
+    refreshEmergencyRecordIndex();
+    return isWritten;
+}
+
+// Append a new version of one visit. Returns 0 if it could not be written.
+int appendEmergencyRecord(const EmergencyPatient* patient) {
+    return appendEmergencyRecords(patient, 1);
+}
+
+// Read the latest version of a visit. Returns 0 if it has never been saved.
+int findEmergencyRecord(const int emergencyId, EmergencyPatient* patient) {
+    refreshEmergencyRecordIndex();
+
+    int slot;
+    if (!intMapGet(&visitIndex, emergencyId, &slot)) return 0;
+
+    FILE *fp = fopen(EMERGENCY_DATAFILE, "r");
+    if (!fp) return 0;
+
+    char line[EMERGENCY_ROW_SIZE];
+    const int found = readRowAt(fp, latestOffsets[slot], line, sizeof(line)) && parseEmergencyRecord(line, patient) &&
+                      patient->emergencyId == emergencyId;
+    fclose(fp);
+    return found;
+}
+
+// Whether the row at `offset` is the latest version of its visit, as of the
+// last refreshEmergencyRecordIndex(). Rows past the indexed part of the
+// file were appended since and are taken as current.
+int isCurrentEmergencyRecord(const int emergencyId, const long offset) {
+    if (offset >= indexedSize) return 1;
+
+    int slot;
+    return !intMapGet(&visitIndex, emergencyId, &slot) || latestOffsets[slot] == offset;
+}
+
+int isCurrentEmergencyRow(const char* row, const long offset) {
+    int emergencyId;
+    return sscanf(row, "%d,", &emergencyId) == 1 && isCurrentEmergencyRecord(emergencyId, offset);
+}
+
+// Rewrite the data file with only the latest version of each visit once
+// superseded rows outnumber live ones. Rows keep their relative order.
+// Other terminals must not be appending, so this runs only when the shared
+// queue is first created. Returns 1 if the file was rewritten.
+int compactEmergencyRecords() {
+    refreshEmergencyRecordIndex();
+    if (staleRowCount < EMERGENCY_COMPACTION_MIN_STALE || staleRowCount < visitCount) return 0;
+
+    FILE *fp = fopen(EMERGENCY_DATAFILE, "r");
+    FILE *tempFp = fopen(EMERGENCY_TEMP_DATAFILE, "w");
+    FILE *idxFp = fopen(EMERGENCY_TEMP_INDEXFILE, "w");
+    if (!fp || !tempFp || !idxFp) {
+        perror("Unable to compact emergency records");
+        if (fp) fclose(fp);
+        if (tempFp) fclose(tempFp);
+        if (idxFp) fclose(idxFp);
+        return 0;
+    }
+
+    char line[EMERGENCY_ROW_SIZE];
+    long rowStart = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strchr(line, '\n')) break;
+        const long rowEnd = ftell(fp);
+
+        int emergencyId;
+        if (sscanf(line, "%d,", &emergencyId) == 1 && isCurrentEmergencyRecord(emergencyId, rowStart)) {
+            fprintf(idxFp, "%d,%ld,%ld\n", emergencyId, ftell(tempFp), rowEnd - rowStart);
+            fputs(line, tempFp);
+        }
+        rowStart = rowEnd;
+    }
+    fclose(fp);
+    fclose(tempFp);
+    fclose(idxFp);
+
+    // The data file goes first: a stale index left by a crash in between
+    // covers more bytes than the new file holds and is rebuilt
+    remove(EMERGENCY_DATAFILE);
+    rename(EMERGENCY_TEMP_DATAFILE, EMERGENCY_DATAFILE);
+    remove(EMERGENCY_RECORD_INDEXFILE);
+    rename(EMERGENCY_TEMP_INDEXFILE, EMERGENCY_RECORD_INDEXFILE);
+
+    resetIndex();
+    isIndexLoaded = 0;
+    refreshEmergencyRecordIndex();
+    invalidateRowIndex(getEmergencyPatientIndex());
+    return 1;
+}
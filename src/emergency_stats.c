@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emergency_stats.h"
+#include "emergency_records.h"
+#include "dateutil.h"
+
+#define EMERGENCY_DATAFILE "data/emergency.csv"
+#define EMERGENCY_EVENTS_FILE "data/emergency_events.csv"
+#define EMERGENCY_STATS_FILE "data/emergency_stats.csv"
+#define EMERGENCY_STATS_TEMP_FILE "data/emergency_stats_temp.csv"
+
+// Upper bound of each sketch bucket, gamma^i
+static double bucketBounds[SKETCH_BUCKETS];
+static int isBucketBoundsInitialized = 0;
+
+static void initializeBucketBounds() {
+    if (isBucketBoundsInitialized) return;
+
+    const double gamma = (1.0 + SKETCH_RELATIVE_ACCURACY) / (1.0 - SKETCH_RELATIVE_ACCURACY);
+    double bound = 1.0;
+    for (int i = 0; i < SKETCH_BUCKETS; i++) {
+        bucketBounds[i] = bound;
+        bound *= gamma;
+    }
+    isBucketBoundsInitialized = 1;
+}
+
+void addSketchValue(QuantileSketch* sketch, const double value) {
+    initializeBucketBounds();
+    sketch->total++;
+    if (value < 1.0) {
+        sketch->zeroCount++;
+        return;
+    }
+
+    // First bucket whose upper bound holds the value
+    int low = 0, high = SKETCH_BUCKETS - 1;
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (bucketBounds[mid] >= value) high = mid;
+        else low = mid + 1;
+    }
+    sketch->counts[low]++;
+}
+
+void mergeQuantileSketch(QuantileSketch* into, const QuantileSketch* from) {
+    into->zeroCount += from->zeroCount;
+    for (int i = 0; i < SKETCH_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+}
+
+// Estimated value at `quantile` (0..1), or 0 for an empty sketch
+double getSketchQuantile(const QuantileSketch* sketch, const double quantile) {
+    if (sketch->total == 0) return 0.0;
+    initializeBucketBounds();
+
+    const double rank = quantile * (sketch->total - 1);
+    double seen = sketch->zeroCount;
+    if (seen > rank) return 0.0;
+
+    for (int i = 0; i < SKETCH_BUCKETS; i++) {
+        seen += sketch->counts[i];
+        if (seen > rank) {
+            // Midpoint of (gamma^(i-1), gamma^i] that keeps the relative error bound
+            const double lower = i > 0 ? bucketBounds[i - 1] : 1.0;
+            return 2.0 * lower * bucketBounds[i] / (lower + bucketBounds[i]);
+        }
+    }
+    return bucketBounds[SKETCH_BUCKETS - 1];
+}
+
+static void writeEmergencyEvent(FILE* fp, const char type, const int emergencyId, const int priority,
+                                const long minutes, const time_t at) {
+    const struct tm* tm_info = localtime(&at);
+    const int packedDate = (tm_info->tm_year + 1900) * 10000 + (tm_info->tm_mon + 1) * 100 + tm_info->tm_mday;
+    fprintf(fp, "%c,%d,%d,%ld,%d,%d\n", type, emergencyId, priority, minutes, packedDate, tm_info->tm_hour);
+}
+
+static void appendEmergencyEvent(const char type, const int emergencyId, const int priority,
+                                 const long minutes, const time_t at) {
+    FILE *fp = fopen(EMERGENCY_EVENTS_FILE, "a");
+    if (!fp) return;
+    writeEmergencyEvent(fp, type, emergencyId, priority, minutes, at);
+    fclose(fp);
+}
+
+void recordEmergencyArrivals(const EmergencyPatient* patients, const int count) {
+    FILE *fp = fopen(EMERGENCY_EVENTS_FILE, "a");
+    if (!fp) return;
+
+    for (int i = 0; i < count; i++) {
+        const time_t arrival = parseDateTime(patients[i].arrivalDate, patients[i].arrivalTime);
+        writeEmergencyEvent(fp, 'A', patients[i].emergencyId, patients[i].priority, 0,
+                            arrival == (time_t)-1 ? time(NULL) : arrival);
+    }
+    fclose(fp);
+}
+
+void recordEmergencyArrival(const EmergencyPatient* patient) {
+    recordEmergencyArrivals(patient, 1);
+}
+
+void recordEmergencyTreatmentStart(const EmergencyPatient* patient) {
+    const long waited = (long)(patient->treatmentStartEpoch - patient->arrivalEpoch) / 60;
+    appendEmergencyEvent('T', patient->emergencyId, patient->priority, waited > 0 ? waited : 0,
+                         patient->treatmentStartEpoch);
+}
+
+void recordEmergencyDischarge(const int emergencyId, const EmergencyPriority priority, const char* arrivalDate,
+                              const char* arrivalTime, const time_t dischargedAt) {
+    const time_t arrival = parseDateTime(arrivalDate, arrivalTime);
+    if (arrival == (time_t)-1) return;
+
+    const long stay = (long)(dischargedAt - arrival) / 60;
+    appendEmergencyEvent('D', emergencyId, priority, stay > 0 ? stay : 0, dischargedAt);
+}
+
+static void noteArrival(EmergencyStats* stats, const int packedDate, const int hour) {
+    if (hour >= 0 && hour < 24) stats->arrivalsByHour[hour]++;
+    if (packedDate > stats->lastArrivalDate) {
+        stats->lastArrivalDate = packedDate;
+        stats->arrivalDays++;
+    }
+}
+
+static void applyEmergencyEvent(EmergencyStats* stats, const char* line) {
+    char type;
+    int emergencyId, priority, packedDate, hour;
+    long minutes;
+    if (sscanf(line, "%c,%d,%d,%ld,%d,%d", &type, &emergencyId, &priority, &minutes, &packedDate, &hour) != 6 ||
+        priority < CRITICAL || priority > LOW) {
+        return;
+    }
+
+    switch (type) {
+        case 'A':
+            noteArrival(stats, packedDate, hour);
+            break;
+        case 'T':
+            addSketchValue(&stats->waitToTreatment[priority], (double)minutes);
+            break;
+        case 'D':
+            addSketchValue(&stats->lengthOfStay[priority], (double)minutes);
+            break;
+        default:
+            break;
+    }
+}
+
+static int readStatsSnapshot(EmergencyStats* stats) {
+    FILE *fp = fopen(EMERGENCY_STATS_FILE, "r");
+    if (!fp) return 0;
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+        char key[16];
+        long a, b = 0, c = 0;
+        const int fields = sscanf(line, "%15[^,],%ld,%ld,%ld", key, &a, &b, &c);
+        if (fields < 2) continue;
+
+        if (strcmp(key, "eventsOffset") == 0) {
+            stats->eventsOffset = a;
+        } else if (strcmp(key, "arrivalDays") == 0) {
+            stats->arrivalDays = (int)a;
+        } else if (strcmp(key, "lastArrivalDate") == 0) {
+            stats->lastArrivalDate = (int)a;
+        } else if (strcmp(key, "hour") == 0 && fields == 3 && a >= 0 && a < 24) {
+            stats->arrivalsByHour[a] = (unsigned int)b;
+        } else if ((strcmp(key, "wait") == 0 || strcmp(key, "stay") == 0) && fields == 4 &&
+                   a >= CRITICAL && a <= LOW && b >= -1 && b < SKETCH_BUCKETS) {
+            QuantileSketch* sketch = key[0] == 'w' ? &stats->waitToTreatment[a] : &stats->lengthOfStay[a];
+            if (b < 0) sketch->zeroCount = (unsigned int)c;
+            else sketch->counts[b] = (unsigned int)c;
+            sketch->total += (unsigned int)c;
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+static void writeSketch(FILE* fp, const char* name, const int priority, const QuantileSketch* sketch) {
+    if (sketch->zeroCount > 0) fprintf(fp, "%s,%d,-1,%u\n", name, priority, sketch->zeroCount);
+    for (int i = 0; i < SKETCH_BUCKETS; i++) {
+        if (sketch->counts[i] > 0) fprintf(fp, "%s,%d,%d,%u\n", name, priority, i, sketch->counts[i]);
+    }
+}
+
+static void writeStatsSnapshot(const EmergencyStats* stats) {
+    FILE *fp = fopen(EMERGENCY_STATS_TEMP_FILE, "w");
+    if (!fp) {
+        perror("Unable to save emergency statistics");
+        return;
+    }
+
+    fprintf(fp, "eventsOffset,%ld\n", stats->eventsOffset);
+    fprintf(fp, "arrivalDays,%d\n", stats->arrivalDays);
+    fprintf(fp, "lastArrivalDate,%d\n", stats->lastArrivalDate);
+    for (int hour = 0; hour < 24; hour++) {
+        if (stats->arrivalsByHour[hour] > 0) fprintf(fp, "hour,%d,%u\n", hour, stats->arrivalsByHour[hour]);
+    }
+    for (int priority = CRITICAL; priority <= LOW; priority++) {
+        writeSketch(fp, "wait", priority, &stats->waitToTreatment[priority]);
+        writeSketch(fp, "stay", priority, &stats->lengthOfStay[priority]);
+    }
+    fclose(fp);
+
+    remove(EMERGENCY_STATS_FILE);
+    rename(EMERGENCY_STATS_TEMP_FILE, EMERGENCY_STATS_FILE);
+}
+
+static long getEventLogSize() {
+    FILE *fp = fopen(EMERGENCY_EVENTS_FILE, "r");
+    if (!fp) return 0;
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+// Seed the statistics from emergency.csv the first time they are needed.
+// Historical rows give arrivals and, for discharged visits, length of stay
+// (assuming discharge within a day); treatment start times were never
+// recorded, so waits are only measured from now on.
+void initializeEmergencyStats() {
+    FILE *existing = fopen(EMERGENCY_STATS_FILE, "r");
+    if (existing) {
+        fclose(existing);
+        return;
+    }
+
+    EmergencyStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    refreshEmergencyRecordIndex();
+    FILE *fp = fopen(EMERGENCY_DATAFILE, "r");
+    if (fp) {
+        char line[1024];
+        EmergencyPatient record;
+        long rowOffset = 0;
+        while (fgets(line, sizeof(line), fp)) {
+            const long rowStart = rowOffset;
+            rowOffset = ftell(fp);
+
+            int hour;
+            if (!parseEmergencyRecord(line, &record) || !isCurrentEmergencyRecord(record.emergencyId, rowStart) ||
+                sscanf(record.arrivalTime, "%d", &hour) != 1) {
+                continue;
+            }
+            noteArrival(&stats, packDate(record.arrivalDate), hour);
+
+            if (strcmp(record.status, "Discharged") != 0) continue;
+            const time_t arrival = parseDateTime(record.arrivalDate, record.arrivalTime);
+            time_t discharge = parseDateTime(record.arrivalDate, record.dischargeTime);
+            if (arrival == (time_t)-1 || discharge == (time_t)-1) continue;
+            if (discharge < arrival) discharge += 24 * 60 * 60;
+            addSketchValue(&stats.lengthOfStay[record.priority], (double)(discharge - arrival) / 60);
+        }
+        fclose(fp);
+    }
+
+    stats.eventsOffset = getEventLogSize();
+    writeStatsSnapshot(&stats);
+}
+
+// Snapshot plus whatever the event log gained since it was written. The
+// snapshot is rewritten when new events were folded, so each event is read
+// about once no matter how often the dashboard is opened.
+int loadEmergencyStats(EmergencyStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!readStatsSnapshot(stats)) {
+        initializeEmergencyStats();
+        memset(stats, 0, sizeof(*stats));
+        if (!readStatsSnapshot(stats)) return 0;
+    }
+
+    FILE *fp = fopen(EMERGENCY_EVENTS_FILE, "r");
+    if (!fp) return 1;
+
+    fseek(fp, 0, SEEK_END);
+    if (stats->eventsOffset > ftell(fp)) stats->eventsOffset = 0;  // Log was replaced
+    fseek(fp, stats->eventsOffset, SEEK_SET);
+
+    const long startOffset = stats->eventsOffset;
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+        // Leave a line another terminal is still writing for next time
+        if (!strchr(line, '\n')) break;
+        applyEmergencyEvent(stats, line);
+        stats->eventsOffset = ftell(fp);
+    }
+    fclose(fp);
+
+    if (stats->eventsOffset != startOffset) writeStatsSnapshot(stats);
+    return 1;
+}
+
+static void printSketchRow(const char* label, const QuantileSketch* sketch) {
+    if (sketch->total == 0) {
+        printf("%-10s %-8u %-8s %-8s %-8s\n", label, 0u, "-", "-", "-");
+        return;
+    }
+    printf("%-10s %-8u %-8.0f %-8.0f %-8.0f\n", label, sketch->total,
+           getSketchQuantile(sketch, 0.50), getSketchQuantile(sketch, 0.90), getSketchQuantile(sketch, 0.99));
+}
+
+static void printSketchTable(const char* title, const QuantileSketch* byPriority) {
+    printf("\n%s (minutes)\n", title);
+    printf("%-10s %-8s %-8s %-8s %-8s\n", "Priority", "Count", "p50", "p90", "p99");
+    printf("----------------------------------------------\n");
+
+    QuantileSketch all;
+    memset(&all, 0, sizeof(all));
+    for (int priority = CRITICAL; priority <= LOW; priority++) {
+        printSketchRow(getPriorityString((EmergencyPriority)priority), &byPriority[priority]);
+        mergeQuantileSketch(&all, &byPriority[priority]);
+    }
+    printSketchRow("ALL", &all);
+}
+
+void printEmergencyAnalytics() {
+    EmergencyStats stats;
+    if (!loadEmergencyStats(&stats)) {
+        printf("\nEmergency statistics are unavailable.\n");
+        return;
+    }
+
+    printf("\n==== Emergency Analytics ====\n");
+    printSketchTable("Arrival to treatment", stats.waitToTreatment);
+    printSketchTable("Arrival to discharge", stats.lengthOfStay);
+
+    const int days = stats.arrivalDays > 0 ? stats.arrivalDays : 1;
+    unsigned int busiest = 0;
+    for (int hour = 0; hour < 24; hour++) {
+        if (stats.arrivalsByHour[hour] > busiest) busiest = stats.arrivalsByHour[hour];
+    }
+
+    printf("\nArrivals per hour (average over %d day%s)\n", days, days == 1 ? "" : "s");
+    for (int hour = 0; hour < 24; hour++) {
+        if (stats.arrivalsByHour[hour] == 0) continue;
+        printf("%02d:00  %6.2f  ", hour, (double)stats.arrivalsByHour[hour] / days);
+        const int bar = (int)(30.0 * stats.arrivalsByHour[hour] / busiest + 0.5);
+        for (int i = 0; i < bar; i++) putchar('#');
+        putchar('\n');
+    }
+    if (busiest == 0) printf("No arrivals recorded.\n");
+}
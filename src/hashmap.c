@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include "hashmap.h"
+
+#define INTMAP_MIN_CAPACITY 16
+
+static unsigned int hashIntKey(const int key) {
+    unsigned int h = (unsigned int)key;
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
+    return h;
+}
+
+static void allocateIntMap(IntMap* map, const int capacity) {
+    map->keys = malloc(sizeof(int) * capacity);
+    map->values = malloc(sizeof(int) * capacity);
+    map->states = calloc(capacity, sizeof(unsigned char));
+    map->capacity = capacity;
+    map->count = 0;
+    map->tombstones = 0;
+}
+
+static void rehashIntMap(IntMap* map, const int newCapacity) {
+    int* oldKeys = map->keys;
+    int* oldValues = map->values;
+    unsigned char* oldStates = map->states;
+    const int oldCapacity = map->capacity;
+
+    allocateIntMap(map, newCapacity);
+    for (int i = 0; i < oldCapacity; i++) {
+        if (oldStates[i] == 1) {
+            intMapPut(map, oldKeys[i], oldValues[i]);
+        }
+    }
+
+    free(oldKeys);
+    free(oldValues);
+    free(oldStates);
+}
+
+void initIntMap(IntMap* map, const int expectedCount) {
+    int capacity = INTMAP_MIN_CAPACITY;
+    while (capacity < expectedCount * 2) capacity *= 2;
+    allocateIntMap(map, capacity);
+}
+
+void freeIntMap(IntMap* map) {
+    free(map->keys);
+    free(map->values);
+    free(map->states);
+    memset(map, 0, sizeof(*map));
+}
+
+void clearIntMap(IntMap* map) {
+    if (map->capacity > 0) {
+        memset(map->states, 0, map->capacity);
+    }
+    map->count = 0;
+    map->tombstones = 0;
+}
+
+void intMapPut(IntMap* map, const int key, const int value) {
+    if (map->capacity == 0) {
+        allocateIntMap(map, INTMAP_MIN_CAPACITY);
+    } else if ((map->count + map->tombstones + 1) * 4 > map->capacity * 3) {
+        // Grow when live entries dominate, otherwise just sweep tombstones
+        const int newCapacity = map->count * 2 >= map->capacity ? map->capacity * 2 : map->capacity;
+        rehashIntMap(map, newCapacity);
+    }
+
+    const unsigned int mask = (unsigned int)map->capacity - 1;
+    unsigned int i = hashIntKey(key) & mask;
+    int firstFree = -1;
+
+    while (map->states[i] != 0) {
+        if (map->states[i] == 1 && map->keys[i] == key) {
+            map->values[i] = value;
+            return;
+        }
+        if (map->states[i] == 2 && firstFree < 0) firstFree = (int)i;
+        i = (i + 1) & mask;
+    }
+
+    if (firstFree >= 0) {
+        i = (unsigned int)firstFree;
+        map->tombstones--;
+    }
+    map->keys[i] = key;
+    map->values[i] = value;
+    map->states[i] = 1;
+    map->count++;
+}
+
+static int findIntMapSlot(const IntMap* map, const int key) {
+    if (map->capacity == 0) return -1;
+
+    const unsigned int mask = (unsigned int)map->capacity - 1;
+    unsigned int i = hashIntKey(key) & mask;
+    while (map->states[i] != 0) {
+        if (map->states[i] == 1 && map->keys[i] == key) return (int)i;
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+int intMapGet(const IntMap* map, const int key, int* value) {
+    const int slot = findIntMapSlot(map, key);
+    if (slot < 0) return 0;
+    if (value) *value = map->values[slot];
+    return 1;
+}
+
+int intMapRemove(IntMap* map, const int key) {
+    const int slot = findIntMapSlot(map, key);
+    if (slot < 0) return 0;
+    map->states[slot] = 2;
+    map->count--;
+    map->tombstones++;
+    return 1;
+}
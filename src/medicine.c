@@ -2,9 +2,29 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 #include "medicine.h"
+#include "hashmap.h"
+#include "skiplist.h"
+#include "text_index.h"
+#include "bitmap.h"
+#include "stock_ledger.h"
+#include "dateutil.h"
+#include "consumption_forecast.h"
+
+#ifdef _WIN32
+#include <conio.h>
+#include <io.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 #define MEDICINE_DATAFILE "data/medicine.csv"
+#define MEDICINE_REORDER_FILE "data/medicine_reorder.csv"
+#define MEDICINE_ALERTS_FILE "data/medicine_alerts.csv"
+#define MEDICINE_SEARCH_RESULTS 10      // Shown while typing a search
+#define MEDICINE_SNAPSHOT_INTERVAL (64 * 1024)  // Ledger bytes between snapshots
 
 static int maxMedicineId = 0;
 static int isMaxMedicineIdInitialized = 0;
@@ -38,27 +58,654 @@ static void setMedicineOrNA(char* dest, const char* input, const size_t size) {
     dest[size - 1] = '\0';
 }
 
-void initializeMaxMedicineId() {
-    if (isMaxMedicineIdInitialized) return;
+// DD/MM/YYYY for a packed expiry date, or "N/A" if there is none
+static void formatExpiryDate(const int expiryDate, char* dest, const size_t size) {
+    if (expiryDate == 0) snprintf(dest, size, "N/A");
+    else unpackDate(expiryDate, dest, size);
+}
 
-    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
-    if (!fp) {
-        maxMedicineId = 0;
-        isMaxMedicineIdInitialized = 1;
+// Resident copy of medicine.csv in file order, loaded on first use and kept
+// in step with every add, stock update and delete made here. The index
+// points each ID at its first row, the one lookups have always returned.
+static Medicine* catalog = NULL;
+static int catalogCount = 0;
+static int catalogCapacity = 0;
+static IntMap catalogIndex;         // medicineId -> first catalog row
+static int isCatalogLoaded = 0;
+
+// medicine.csv is a snapshot: its first line records how much of the stock
+// ledger its quantities include, and current stock is the snapshot plus the
+// ledger rows after that point.
+static long ledgerOffset = -1;          // Ledger bytes applied; -1 to reread medicine.csv
+static long snapshotOffset = 0;         // Ledger bytes included in medicine.csv
+
+// Catalog rows with an expiry date, soonest first, rebuilt after the
+// catalog gains or loses rows. Quantities change without touching it.
+static int* expiryOrder = NULL;
+static int expiryOrderCount = 0;
+static int isExpiryOrderValid = 0;
+
+// Catalog rows by quantity, so a low-stock query reads only the rows below
+// its threshold. Kept in step with every quantity change once built.
+static IntSkipList quantityIndex;
+static int isQuantityIndexValid = 0;
+
+// Reorder points set per medicine; a stock change that takes a medicine
+// down to its reorder point raises a low-stock alert
+static int* reorderMedicineIds = NULL;
+static int* reorderLevels = NULL;
+static int reorderCount = 0;
+static int reorderCapacity = 0;
+static IntMap reorderIndex;             // medicineId -> reorder slot
+
+// Names and manufacturers of the catalog rows, rebuilt after the catalog
+// gains or loses rows
+static TextIndex nameIndex;
+static int isNameIndexValid = 0;
+
+// Categories are dictionary-encoded: each distinct name, ignoring case,
+// gets a code with a bitmap of its catalog rows, which also gives the
+// medicine count, and a unit total kept up to date as quantities change
+typedef struct {
+    char name[30];
+    RowBitmap rows;
+    int unitsInStock;
+} CategoryEntry;
+
+static CategoryEntry* categories = NULL;
+static int categoryCount = 0;
+static int categoryCapacity = 0;
+static int* rowCategories = NULL;       // Category code of each catalog row
+static int rowCategoryCapacity = 0;
+
+// Scratch sets for category queries
+static RowBitmap categoryMatches;
+static RowBitmap categoryFilter;
+
+static int isSameMedicineName(const char* a, const char* b) {
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return 0;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static int getCategoryCode(const char* name) {
+    for (int i = 0; i < categoryCount; i++) {
+        if (isSameMedicineName(categories[i].name, name)) return i;
+    }
+
+    if (categoryCount == categoryCapacity) {
+        categoryCapacity = categoryCapacity ? categoryCapacity * 2 : 16;
+        categories = realloc(categories, sizeof(CategoryEntry) * categoryCapacity);
+    }
+    CategoryEntry* entry = &categories[categoryCount];
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->name, name, sizeof(entry->name) - 1);
+    return categoryCount++;
+}
+
+static void addRowToCategory(const int row) {
+    if (row >= rowCategoryCapacity) {
+        rowCategoryCapacity = catalogCapacity;
+        rowCategories = realloc(rowCategories, sizeof(int) * rowCategoryCapacity);
+    }
+
+    const int code = getCategoryCode(catalog[row].category);
+    rowCategories[row] = code;
+    setRowBit(&categories[code].rows, row);
+    categories[code].unitsInStock += catalog[row].quantity;
+}
+
+// Empty every category but keep the codes, which stay valid for the run
+static void resetCategoryFacets() {
+    for (int i = 0; i < categoryCount; i++) {
+        clearRowBitmap(&categories[i].rows);
+        categories[i].unitsInStock = 0;
+    }
+}
+
+static void appendCatalogRow(const Medicine* medicine) {
+    if (catalogCount == catalogCapacity) {
+        catalogCapacity = catalogCapacity ? catalogCapacity * 2 : 64;
+        catalog = realloc(catalog, sizeof(Medicine) * catalogCapacity);
+    }
+    catalog[catalogCount] = *medicine;
+    if (!intMapGet(&catalogIndex, medicine->medicineId, NULL)) {
+        intMapPut(&catalogIndex, medicine->medicineId, catalogCount);
+    }
+    if (isQuantityIndexValid) intSkipListInsert(&quantityIndex, medicine->quantity, catalogCount);
+    addRowToCategory(catalogCount);
+    catalogCount++;
+    isExpiryOrderValid = 0;
+    isNameIndexValid = 0;
+
+    if (medicine->medicineId > maxMedicineId) maxMedicineId = medicine->medicineId;
+}
+
+static void rebuildCatalogIndex() {
+    clearIntMap(&catalogIndex);
+    isExpiryOrderValid = 0;
+    isQuantityIndexValid = 0;
+    isNameIndexValid = 0;
+    resetCategoryFacets();
+    for (int i = 0; i < catalogCount; i++) {
+        if (!intMapGet(&catalogIndex, catalog[i].medicineId, NULL)) {
+            intMapPut(&catalogIndex, catalog[i].medicineId, i);
+        }
+        addRowToCategory(i);
+    }
+}
+
+static void buildQuantityIndex() {
+    if (isQuantityIndexValid) return;
+
+    clearIntSkipList(&quantityIndex);
+    for (int i = 0; i < catalogCount; i++) {
+        intSkipListInsert(&quantityIndex, catalog[i].quantity, i);
+    }
+    isQuantityIndexValid = 1;
+}
+
+static void setCatalogQuantity(const int row, const int quantity) {
+    if (isQuantityIndexValid) {
+        intSkipListRemove(&quantityIndex, catalog[row].quantity, row);
+        intSkipListInsert(&quantityIndex, quantity, row);
+    }
+    categories[rowCategories[row]].unitsInStock += quantity - catalog[row].quantity;
+    catalog[row].quantity = quantity;
+}
+
+static void putReorderPoint(const int medicineId, const int reorderPoint) {
+    int slot;
+    if (intMapGet(&reorderIndex, medicineId, &slot)) {
+        reorderLevels[slot] = reorderPoint;
         return;
     }
 
+    if (reorderCount == reorderCapacity) {
+        reorderCapacity = reorderCapacity ? reorderCapacity * 2 : 32;
+        reorderMedicineIds = realloc(reorderMedicineIds, sizeof(int) * reorderCapacity);
+        reorderLevels = realloc(reorderLevels, sizeof(int) * reorderCapacity);
+    }
+    reorderMedicineIds[reorderCount] = medicineId;
+    reorderLevels[reorderCount] = reorderPoint;
+    intMapPut(&reorderIndex, medicineId, reorderCount);
+    reorderCount++;
+}
+
+static void loadReorderPoints() {
+    clearIntMap(&reorderIndex);
+    reorderCount = 0;
+
+    FILE *fp = fopen(MEDICINE_REORDER_FILE, "r");
+    if (!fp) return;
+
+    char line[64];
+    while (fgets(line, sizeof(line), fp)) {
+        int medicineId, reorderPoint;
+        if (sscanf(line, "%d,%d", &medicineId, &reorderPoint) == 2 && reorderPoint > 0) {
+            putReorderPoint(medicineId, reorderPoint);
+        }
+    }
+    fclose(fp);
+}
+
+// The reorder point of a medicine, or 0 if none is set
+static int getReorderPoint(const int medicineId) {
+    int slot;
+    return intMapGet(&reorderIndex, medicineId, &slot) ? reorderLevels[slot] : 0;
+}
+
+// Tell whoever is at this terminal and leave a record for everyone else
+static void raiseLowStockAlert(const Medicine* medicine, const int reorderPoint) {
+    printf("\n*** Low stock: %s (ID %d) is down to %d, reorder point %d ***\n",
+           medicine->name, medicine->medicineId, medicine->quantity, reorderPoint);
+
+    FILE *fp = fopen(MEDICINE_ALERTS_FILE, "a");
+    if (!fp) return;
+    fprintf(fp, "%ld,%d,%d,%d\n", (long)time(NULL), medicine->medicineId, medicine->quantity, reorderPoint);
+    fclose(fp);
+}
+
+// The ledger offset recorded in medicine.csv, or 0 for a file without one
+static long readSnapshotOffset(FILE* fp) {
+    char line[64];
+    long offset = 0;
+    if (fgets(line, sizeof(line), fp) && sscanf(line, "snapshot,%ld", &offset) == 1) return offset;
+
+    rewind(fp);
+    return 0;
+}
+
+static void readCatalogRows() {
+    catalogCount = 0;
+    clearIntMap(&catalogIndex);
+    isQuantityIndexValid = 0;
+    resetCategoryFacets();
+    snapshotOffset = 0;
+    loadReorderPoints();
+
+    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
+    if (!fp) return;
+    snapshotOffset = readSnapshotOffset(fp);
+
+    char line[512];
+    char price[MONEY_TEXT_SIZE];
+    char expiryDate[12];
     Medicine medicine;
-    maxMedicineId = 0;
-    while (fscanf(fp, "%d,%49[^,],%29[^,],%d,%f,%11[^,],%49[^,],%199[^\n]",
-                  &medicine.medicineId, medicine.name, medicine.category,
-                  &medicine.quantity, &medicine.price, medicine.expiryDate,
-                  medicine.manufacturer, medicine.description) == 8) {
-        if (medicine.medicineId > maxMedicineId) {
-            maxMedicineId = medicine.medicineId;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%d,%49[^,],%29[^,],%d,%23[^,],%11[^,],%49[^,],%199[^\n]",
+                   &medicine.medicineId, medicine.name, medicine.category,
+                   &medicine.quantity, price, expiryDate,
+                   medicine.manufacturer, medicine.description) == 8 &&
+            parseMoney(price, &medicine.price)) {
+            medicine.expiryDate = packDate(expiryDate);
+            appendCatalogRow(&medicine);
         }
     }
     fclose(fp);
+}
+
+// Whether medicine.csv holds a snapshot taken at or after ledger byte `offset`
+static int hasSnapshotFrom(const long offset) {
+    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
+    if (!fp) return 0;
+    const long fileOffset = readSnapshotOffset(fp);
+    fclose(fp);
+    return fileOffset >= offset;
+}
+
+// Apply ledger rows added since the last sync. Caller holds the lock.
+static void syncStockLedger(FILE* ledger) {
+    if (ledgerOffset < 0) {
+        readCatalogRows();
+        ledgerOffset = snapshotOffset;
+    }
+
+    fseek(ledger, ledgerOffset, SEEK_SET);
+    StockMovement movement;
+    while (readStockMovement(ledger, &movement)) {
+        ledgerOffset = ftell(ledger);
+
+        if (movement.type == STOCK_SNAPSHOT) {
+            // Another terminal rewrote medicine.csv here, maybe adding or
+            // dropping medicines. A snapshot row without its file (the
+            // rewrite failed) changes nothing.
+            if (hasSnapshotFrom(ledgerOffset)) {
+                readCatalogRows();
+                ledgerOffset = snapshotOffset;
+                fseek(ledger, ledgerOffset, SEEK_SET);
+            }
+            continue;
+        }
+
+        int row;
+        if (intMapGet(&catalogIndex, movement.medicineId, &row)) {
+            setCatalogQuantity(row, catalog[row].quantity + movement.quantity);
+        }
+    }
+}
+
+// Pick up stock changes made by other terminals since the last look
+static void refreshMedicineCatalog() {
+    FILE *ledger = openStockLedger();
+    if (ledger) {
+        syncStockLedger(ledger);
+        closeStockLedger(ledger);
+    } else if (!isCatalogLoaded) {
+        readCatalogRows();
+    }
+    isCatalogLoaded = 1;
+}
+
+static void loadMedicineCatalog() {
+    if (!isCatalogLoaded) refreshMedicineCatalog();
+}
+
+// Drop the catalog so the next lookup reads medicine.csv again
+void invalidateMedicineCatalog() {
+    isCatalogLoaded = 0;
+    ledgerOffset = -1;
+}
+
+// The catalog record for an ID, or NULL if there is none. The pointer is
+// valid until the catalog next changes.
+const Medicine* lookupMedicine(const int medicineId) {
+    loadMedicineCatalog();
+
+    int row;
+    if (!intMapGet(&catalogIndex, medicineId, &row)) return NULL;
+    return &catalog[row];
+}
+
+const Medicine* getMedicineCatalog(int* count) {
+    loadMedicineCatalog();
+    *count = catalogCount;
+    return catalog;
+}
+
+static int compareExpiryRows(const void* a, const void* b) {
+    const int rowA = *(const int*)a, rowB = *(const int*)b;
+    if (catalog[rowA].expiryDate != catalog[rowB].expiryDate) {
+        return catalog[rowA].expiryDate < catalog[rowB].expiryDate ? -1 : 1;
+    }
+    return rowA - rowB;
+}
+
+static void buildExpiryOrder() {
+    loadMedicineCatalog();
+    if (isExpiryOrderValid) return;
+
+    expiryOrder = realloc(expiryOrder, sizeof(int) * (catalogCount > 0 ? catalogCount : 1));
+    expiryOrderCount = 0;
+    for (int i = 0; i < catalogCount; i++) {
+        if (catalog[i].expiryDate != 0) expiryOrder[expiryOrderCount++] = i;
+    }
+    qsort(expiryOrder, expiryOrderCount, sizeof(int), compareExpiryRows);
+    isExpiryOrderValid = 1;
+}
+
+// Position in the expiry order of the first row expiring on or after `packedDate`
+static int firstExpiringFrom(const int packedDate) {
+    int low = 0, high = expiryOrderCount;
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (catalog[expiryOrder[mid]].expiryDate < packedDate) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Medicines with stock that expire on or before `cutoffDate`, soonest
+// first, including those already expired. Only the rows up to the cutoff
+// are visited. Returns how many were stored in `medicines`.
+int findExpiringMedicines(const int cutoffDate, const Medicine** medicines, const int maxCount) {
+    buildExpiryOrder();
+
+    int found = 0;
+    for (int i = 0; i < expiryOrderCount && found < maxCount; i++) {
+        const Medicine* medicine = &catalog[expiryOrder[i]];
+        if (medicine->expiryDate > cutoffDate) break;
+        if (medicine->quantity > 0) medicines[found++] = medicine;
+    }
+    return found;
+}
+
+// Medicines with fewer than `threshold` units, lowest stock first. Only
+// the rows below the threshold are visited. Returns how many were stored.
+int findLowStockMedicines(const int threshold, const Medicine** medicines, const int maxCount) {
+    loadMedicineCatalog();
+    buildQuantityIndex();
+
+    int found = 0;
+    for (const IntSkipListNode* node = intSkipListFirst(&quantityIndex);
+         node && node->key < threshold && found < maxCount; node = node->next[0]) {
+        medicines[found++] = &catalog[node->value];
+    }
+    return found;
+}
+
+static void buildNameIndex() {
+    if (isNameIndexValid) return;
+
+    clearTextIndex(&nameIndex);
+    for (int i = 0; i < catalogCount; i++) {
+        addTextIndexEntry(&nameIndex, catalog[i].name, i, 0);
+        if (strcmp(catalog[i].manufacturer, "N/A") != 0) {
+            addTextIndexEntry(&nameIndex, catalog[i].manufacturer, i, 1);
+        }
+    }
+    isNameIndexValid = 1;
+}
+
+// Medicines whose name or manufacturer contains `query`, ignoring case.
+// Queries of four letters or more tolerate a typo, eight or more two.
+// Best matches come first: fewest typos, names before manufacturers, then
+// prefixes before word starts before the middle of a word.
+int searchMedicines(const char* query, const Medicine** medicines, const int maxCount) {
+    loadMedicineCatalog();
+    buildNameIndex();
+
+    const size_t length = strlen(query);
+    const int maxEdits = length >= 8 ? 2 : length >= 4 ? 1 : 0;
+    TextMatch* matches = malloc(sizeof(TextMatch) * (maxCount > 0 ? maxCount : 1));
+    const int found = searchTextIndex(&nameIndex, query, maxEdits, matches, maxCount);
+    for (int i = 0; i < found; i++) {
+        medicines[i] = &catalog[matches[i].id];
+    }
+    free(matches);
+    return found;
+}
+
+// Facet counts for every category that has medicines, in the order the
+// categories were first seen. Returns how many were stored in `facets`.
+int getCategoryFacets(CategoryFacet* facets, const int maxCount) {
+    loadMedicineCatalog();
+
+    int found = 0;
+    for (int i = 0; i < categoryCount && found < maxCount; i++) {
+        const int medicineCount = countRowBits(&categories[i].rows);
+        if (medicineCount == 0) continue;
+        facets[found].name = categories[i].name;
+        facets[found].medicineCount = medicineCount;
+        facets[found].unitsInStock = categories[i].unitsInStock;
+        found++;
+    }
+    return found;
+}
+
+// Medicines in `category` that also have fewer than `belowStock` units and
+// expire on or before `expiringBy`; 0 skips either filter. Each filter is
+// a bitmap of the rows it selects, so the answer is their intersection.
+// Returns how many were stored in `medicines`, in catalog order.
+int findCategoryMedicines(const char* category, const int belowStock, const int expiringBy,
+                          const Medicine** medicines, const int maxCount) {
+    loadMedicineCatalog();
+
+    int code = -1;
+    for (int i = 0; i < categoryCount; i++) {
+        if (isSameMedicineName(categories[i].name, category)) code = i;
+    }
+    if (code < 0) return 0;
+    copyRowBitmap(&categoryMatches, &categories[code].rows);
+
+    if (belowStock > 0) {
+        buildQuantityIndex();
+        clearRowBitmap(&categoryFilter);
+        for (const IntSkipListNode* node = intSkipListFirst(&quantityIndex);
+             node && node->key < belowStock; node = node->next[0]) {
+            setRowBit(&categoryFilter, node->value);
+        }
+        intersectRowBitmaps(&categoryMatches, &categoryFilter);
+    }
+
+    if (expiringBy > 0) {
+        buildExpiryOrder();
+        clearRowBitmap(&categoryFilter);
+        for (int i = 0; i < expiryOrderCount && catalog[expiryOrder[i]].expiryDate <= expiringBy; i++) {
+            setRowBit(&categoryFilter, expiryOrder[i]);
+        }
+        intersectRowBitmaps(&categoryMatches, &categoryFilter);
+    }
+
+    int found = 0;
+    for (int row = nextSetRow(&categoryMatches, 0); row >= 0 && found < maxCount;
+         row = nextSetRow(&categoryMatches, row + 1)) {
+        medicines[found++] = &catalog[row];
+    }
+    return found;
+}
+
+// The in-stock, unexpired lot of a medicine (catalog entries sharing its
+// name) that expires first, or NULL if there is none
+static const Medicine* findFirstExpiringLot(const char* name, const int today) {
+    buildExpiryOrder();
+
+    for (int i = firstExpiringFrom(today); i < expiryOrderCount; i++) {
+        const Medicine* lot = &catalog[expiryOrder[i]];
+        if (lot->quantity > 0 && isSameMedicineName(lot->name, name)) return lot;
+    }
+    return NULL;
+}
+
+// First-expiry-first-out: when another lot of the same medicine expires
+// sooner, or this one is expired or out of stock, offer the lot to use
+// instead. Returns the lot to dispense from.
+Medicine chooseMedicineLot(const Medicine* medicine) {
+    const int today = getTodayPackedDate();
+    const int isExpired = medicine->expiryDate != 0 && medicine->expiryDate < today;
+    char expiryDate[12];
+
+    if (isExpired) {
+        formatExpiryDate(medicine->expiryDate, expiryDate, sizeof(expiryDate));
+        printf("Warning: %s (ID %d) expired on %s.\n", medicine->name, medicine->medicineId, expiryDate);
+    }
+
+    const Medicine* lot = findFirstExpiringLot(medicine->name, today);
+    if (!lot || lot->medicineId == medicine->medicineId) return *medicine;
+    if (!isExpired && medicine->quantity > 0 &&
+        (medicine->expiryDate == 0 || lot->expiryDate >= medicine->expiryDate)) {
+        return *medicine;
+    }
+
+    formatExpiryDate(lot->expiryDate, expiryDate, sizeof(expiryDate));
+    printf("Lot ID %d of %s expires first (%s, %d in stock). Use it instead? (y/n): ",
+           lot->medicineId, lot->name, expiryDate, lot->quantity);
+    char answer[16];
+    if (fgets(answer, sizeof(answer), stdin) && tolower((unsigned char)answer[0]) == 'y') {
+        return *lot;
+    }
+    return *medicine;
+}
+
+// Take a snapshot: mark the ledger and rewrite medicine.csv with the
+// quantities up to the mark. Caller holds the lock on `ledger` and has
+// synced it. Returns 0 if medicine.csv could not be written.
+static int writeMedicineCatalog(FILE* ledger) {
+    const long markOffset = appendStockMovement(ledger, STOCK_SNAPSHOT, 0, 0);
+    if (markOffset < 0) return 0;
+
+    FILE *temp = fopen("data/temp_medicine.csv", "w");
+    if (!temp) return 0;
+
+    fprintf(temp, "snapshot,%ld\n", markOffset);
+    for (int i = 0; i < catalogCount; i++) {
+        const Medicine* medicine = &catalog[i];
+        char price[MONEY_TEXT_SIZE];
+        char expiryDate[12];
+        formatMoney(medicine->price, price, sizeof(price));
+        formatExpiryDate(medicine->expiryDate, expiryDate, sizeof(expiryDate));
+        fprintf(temp, "%d,%s,%s,%d,%s,%s,%s,%s\n",
+                medicine->medicineId, medicine->name, medicine->category,
+                medicine->quantity, price, expiryDate,
+                medicine->manufacturer, medicine->description);
+    }
+    fclose(temp);
+
+    // Replace original file with updated file
+    remove(MEDICINE_DATAFILE);
+    rename("data/temp_medicine.csv", MEDICINE_DATAFILE);
+
+    ledgerOffset = markOffset;
+    snapshotOffset = markOffset;
+    return 1;
+}
+
+// Record stock movements of one type and apply them to the catalog with
+// a single ledger write, raising an alert for any medicine they take down
+// to its reorder point. Caller holds the lock on `ledger` and has synced
+// it. A snapshot is taken every so often so loading never has to replay
+// much of the ledger. Returns 0, changing nothing, if the write failed.
+static int recordStockMovements(FILE* ledger, const StockMovementType type, const int* rows,
+                                const int* quantities, const int count) {
+    int* medicineIds = malloc(sizeof(int) * (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) {
+        medicineIds[i] = catalog[rows[i]].medicineId;
+    }
+    const long endOffset = appendStockMovements(ledger, type, medicineIds, quantities, count);
+    free(medicineIds);
+    if (endOffset < 0) return 0;
+    ledgerOffset = endOffset;
+
+    for (int i = 0; i < count; i++) {
+        const int row = rows[i];
+        const int previousQuantity = catalog[row].quantity;
+        setCatalogQuantity(row, previousQuantity + quantities[i]);
+
+        const int reorderPoint = getReorderPoint(catalog[row].medicineId);
+        if (reorderPoint > 0 && previousQuantity > reorderPoint && catalog[row].quantity <= reorderPoint) {
+            raiseLowStockAlert(&catalog[row], reorderPoint);
+        }
+    }
+
+    if (ledgerOffset - snapshotOffset > MEDICINE_SNAPSHOT_INTERVAL) {
+        writeMedicineCatalog(ledger);
+    }
+    return 1;
+}
+
+static int recordStockMovement(FILE* ledger, const StockMovementType type, const int row, const int quantity) {
+    return recordStockMovements(ledger, type, &row, &quantity, 1);
+}
+
+// Apply one stock movement under the ledger lock, refusing an empty one or
+// any that would take stock below zero. Returns 1 on success, otherwise 0 with the units
+// on hand in *available (-1 if unknown).
+static int postMedicineStockChange(const int medicineId, const StockMovementType type, const int change,
+                                   int* available) {
+    FILE *ledger = openStockLedger();
+    if (!ledger) {
+        perror("Unable to open medicine stock ledger");
+        *available = 0;
+        return 0;
+    }
+    syncStockLedger(ledger);
+    isCatalogLoaded = 1;
+
+    int row;
+    if (!intMapGet(&catalogIndex, medicineId, &row)) {
+        closeStockLedger(ledger);
+        *available = -1;
+        return 0;
+    }
+
+    *available = catalog[row].quantity;
+    if (change == 0 || catalog[row].quantity + change < 0) {
+        closeStockLedger(ledger);
+        return 0;
+    }
+
+    const int isRecorded = recordStockMovement(ledger, type, row, change);
+    *available = catalog[row].quantity;
+    closeStockLedger(ledger);
+    return isRecorded;
+}
+
+// Take `quantity` units of a medicine out of stock for a prescription or a
+// treatment. The check and the decrement happen under the ledger lock, so
+// two terminals can never hand out the same units. Returns 1 on success,
+// otherwise 0 with the units on hand in *available (-1 if unknown).
+int reserveMedicineStock(const int medicineId, const int quantity, int* available) {
+    // A zero change is refused, which also reports the units on hand
+    return postMedicineStockChange(medicineId, STOCK_DISPENSE, quantity > 0 ? -quantity : 0, available);
+}
+
+// Correct stock already dispensed, e.g. units returned when a prescription
+// is deleted or could not be saved (positive `change`), or more taken when
+// one is edited upward (negative). Same return as reserveMedicineStock.
+int adjustMedicineStock(const int medicineId, const int change, int* available) {
+    if (change == 0) {
+        *available = 0;
+        return 1;
+    }
+    return postMedicineStockChange(medicineId, STOCK_ADJUSTMENT, change, available);
+}
+
+void initializeMaxMedicineId() {
+    if (isMaxMedicineIdInitialized) return;
+    loadMedicineCatalog();
     isMaxMedicineIdInitialized = 1;
 }
 
@@ -84,29 +731,44 @@ void makeMedicineEntry(Medicine* medicine) {
         system("mkdir -p data");
     #endif
 
-    FILE *fp = fopen(MEDICINE_DATAFILE, "a");
-    if (!fp) {
-        fp = fopen(MEDICINE_DATAFILE, "w");
-        if (!fp) {
-            perror("Unable to create medicine data file");
-            printf("Press Enter to return to menu...");
-            getchar();
-            return;
-        }
-        fclose(fp);
-        fp = fopen(MEDICINE_DATAFILE, "a");
+    // Other terminals only pick up new medicines from a snapshot, so one is
+    // taken straight away
+    FILE *ledger = openStockLedger();
+    if (!ledger) {
+        perror("Unable to open medicine stock ledger");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
     }
+    syncStockLedger(ledger);
+    isCatalogLoaded = 1;
 
     if (medicine->medicineId == 0) {
         medicine->medicineId = generateMedicineId();
     }
 
-    fprintf(fp, "%d,%s,%s,%d,%.2f,%s,%s,%s\n",
-            medicine->medicineId, medicine->name, medicine->category,
-            medicine->quantity, medicine->price, medicine->expiryDate,
-            medicine->manufacturer, medicine->description);
+    // The opening stock goes through the ledger as a receipt
+    Medicine entry = *medicine;
+    entry.quantity = 0;
+    appendCatalogRow(&entry);
+    int row;
+    intMapGet(&catalogIndex, medicine->medicineId, &row);
+    if (row == catalogCount - 1 && medicine->quantity > 0) {
+        recordStockMovement(ledger, STOCK_RECEIPT, row, medicine->quantity);
+    } else {
+        setCatalogQuantity(catalogCount - 1, medicine->quantity);
+    }
+
+    const int isWritten = writeMedicineCatalog(ledger);
+    closeStockLedger(ledger);
+    if (!isWritten) {
+        invalidateMedicineCatalog();
+        perror("Unable to create medicine data file");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
 
-    fclose(fp);
     printf("Medicine added successfully with ID: %d\n", medicine->medicineId);
     printf("Press Enter to return to menu...");
     getchar();
@@ -132,11 +794,11 @@ Medicine makeMedicine() {
 
     // Price
     getMedicineInput("Price: ", buffer, sizeof(buffer));
-    medicine.price = (float)atof(buffer);
+    if (!parseMoney(buffer, &medicine.price)) medicine.price = 0;
 
     // Expiry date
     getMedicineInput("Expiry date (DD/MM/YYYY): ", buffer, sizeof(buffer));
-    setMedicineOrNA(medicine.expiryDate, buffer, sizeof(medicine.expiryDate));
+    medicine.expiryDate = packDate(buffer);
 
     // Manufacturer
     getMedicineInput("Manufacturer: ", buffer, sizeof(buffer));
@@ -151,23 +813,8 @@ Medicine makeMedicine() {
 
 Medicine findMedicine(const int medicineId) {
     Medicine medicine = {0};
-    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
-    if (!fp) {
-        printf("Unable to open medicine data file\n");
-        return medicine;
-    }
-
-    while (fscanf(fp, "%d,%49[^,],%29[^,],%d,%f,%11[^,],%49[^,],%199[^\n]",
-                  &medicine.medicineId, medicine.name, medicine.category,
-                  &medicine.quantity, &medicine.price, medicine.expiryDate,
-                  medicine.manufacturer, medicine.description) == 8) {
-        if (medicine.medicineId == medicineId) {
-            fclose(fp);
-            return medicine;
-        }
-    }
-    fclose(fp);
-    medicine.medicineId = 0; // Not found
+    const Medicine* found = lookupMedicine(medicineId);
+    if (found) medicine = *found;
     return medicine;
 }
 
@@ -177,36 +824,62 @@ void showMedicine(Medicine* medicine) {
     printf("Name: %s\n", medicine->name);
     printf("Category: %s\n", medicine->category);
     printf("Quantity: %d\n", medicine->quantity);
-    printf("Price: $%.2f\n", medicine->price);
-    printf("Expiry Date: %s\n", medicine->expiryDate);
+    char price[MONEY_TEXT_SIZE];
+    formatMoney(medicine->price, price, sizeof(price));
+    printf("Price: $%s\n", price);
+    char expiryDate[12];
+    formatExpiryDate(medicine->expiryDate, expiryDate, sizeof(expiryDate));
+    printf("Expiry Date: %s\n", expiryDate);
     printf("Manufacturer: %s\n", medicine->manufacturer);
     printf("Description: %s\n", medicine->description);
     printf("============================\n");
 }
 
 void listAllMedicines() {
-    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
-    if (!fp) {
-        printf("No medicine data file found or unable to open file.\n");
+    refreshMedicineCatalog();
+    int count;
+    const Medicine* medicines = getMedicineCatalog(&count);
+    if (count == 0) {
+        printf("No medicines found in inventory.\n");
         printf("Press Enter to return to menu...");
         getchar();
         return;
     }
 
-    Medicine medicine;
+    refreshConsumptionForecast();
+
     printf("\n==== All Medicines ====\n");
-    printf("%-5s %-20s %-15s %-8s %-8s %-12s\n", "ID", "Name", "Category", "Quantity", "Price", "Expiry");
-    printf("----------------------------------------------------------------\n");
+    printf("%-5s %-20s %-15s %-8s %-8s %-12s %-9s\n", "ID", "Name", "Category", "Quantity", "Price", "Expiry", "Days Left");
+    printf("--------------------------------------------------------------------------\n");
+
+    for (int i = 0; i < count; i++) {
+        const Medicine* medicine = &medicines[i];
+        char price[MONEY_TEXT_SIZE];
+        char expiryDate[12];
+        formatMoney(medicine->price, price, sizeof(price));
+        formatExpiryDate(medicine->expiryDate, expiryDate, sizeof(expiryDate));
+
+        // Days the stock lasts at the forecast consumption
+        char daysLeft[8];
+        const int days = getDaysOfStockRemaining(medicine->medicineId, medicine->quantity);
+        if (days < 0) strcpy(daysLeft, "-");
+        else if (days > FORECAST_HORIZON_DAYS) snprintf(daysLeft, sizeof(daysLeft), ">%d", FORECAST_HORIZON_DAYS);
+        else snprintf(daysLeft, sizeof(daysLeft), "%d", days);
+
+        printf("%-5d %-20s %-15s %-8d Tk.%-7s %-12s %-9s\n",
+               medicine->medicineId, medicine->name, medicine->category,
+               medicine->quantity, price, expiryDate, daysLeft);
+    }
 
-    while (fscanf(fp, "%d,%49[^,],%29[^,],%d,%f,%11[^,],%49[^,],%199[^\n]",
-                  &medicine.medicineId, medicine.name, medicine.category,
-                  &medicine.quantity, &medicine.price, medicine.expiryDate,
-                  medicine.manufacturer, medicine.description) == 8) {
-        printf("%-5d %-20s %-15s %-8d Tk.%-7.2f %-12s\n",
-               medicine.medicineId, medicine.name, medicine.category,
-               medicine.quantity, medicine.price, medicine.expiryDate);
+    CategoryFacet* facets = malloc(sizeof(CategoryFacet) * count);
+    const int facetCount = getCategoryFacets(facets, count);
+    printf("\n%-20s %-10s %-8s\n", "Category", "Medicines", "Units");
+    printf("--------------------------------------\n");
+    for (int i = 0; i < facetCount; i++) {
+        printf("%-20s %-10d %-8d\n", facets[i].name, facets[i].medicineCount, facets[i].unitsInStock);
     }
-    fclose(fp);
+    free(facets);
+
     printf("\nPress Enter to return to menu...");
     getchar();
 }
@@ -217,45 +890,92 @@ void listLowStockMedicines() {
     scanf("%d", &threshold);
     getchar(); // consume newline
 
-    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
-    if (!fp) {
-        printf("No medicine data file found.\n");
-        printf("Press Enter to return to menu...");
-        getchar();
-        return;
-    }
+    refreshMedicineCatalog();
+    int count;
+    getMedicineCatalog(&count);
+    const Medicine** medicines = malloc(sizeof(Medicine*) * (count > 0 ? count : 1));
+    const int found = findLowStockMedicines(threshold, medicines, count);
 
-    Medicine medicine;
     printf("\n==== Low Stock Medicines (< %d) ====\n", threshold);
     printf("%-5s %-20s %-8s\n", "ID", "Name", "Quantity");
     printf("--------------------------------\n");
 
-    int found = 0;
-    while (fscanf(fp, "%d,%49[^,],%29[^,],%d,%f,%11[^,],%49[^,],%199[^\n]",
-                  &medicine.medicineId, medicine.name, medicine.category,
-                  &medicine.quantity, &medicine.price, medicine.expiryDate,
-                  medicine.manufacturer, medicine.description) == 8) {
-        if (medicine.quantity < threshold) {
-            printf("%-5d %-20s %-8d\n", medicine.medicineId, medicine.name, medicine.quantity);
-            found = 1;
-        }
+    for (int i = 0; i < found; i++) {
+        printf("%-5d %-20s %-8d\n", medicines[i]->medicineId, medicines[i]->name, medicines[i]->quantity);
     }
+    free(medicines);
 
-    if (!found) {
+    if (found == 0) {
         printf("No medicines found with low stock.\n");
     }
 
-    fclose(fp);
+    // Medicines at or below their own reorder point, whatever the threshold
+    int isHeaderPrinted = 0;
+    for (int i = 0; i < reorderCount; i++) {
+        if (reorderLevels[i] <= 0) continue;
+        const Medicine* medicine = lookupMedicine(reorderMedicineIds[i]);
+        if (!medicine || medicine->quantity > reorderLevels[i]) continue;
+
+        if (!isHeaderPrinted) {
+            printf("\n==== At or Below Reorder Point ====\n");
+            printf("%-5s %-20s %-8s %-8s\n", "ID", "Name", "Quantity", "Reorder");
+            printf("-----------------------------------------\n");
+            isHeaderPrinted = 1;
+        }
+        printf("%-5d %-20s %-8d %-8d\n", medicine->medicineId, medicine->name, medicine->quantity, reorderLevels[i]);
+    }
+
     printf("\nPress Enter to return to menu...");
     getchar();
 }
 
+// Set or clear (with 0) the stock level at which a medicine raises a
+// low-stock alert
+void setMedicineReorderPoint() {
+    int medicineId, reorderPoint;
+    printf("Enter Medicine ID: ");
+    scanf("%d", &medicineId);
+    getchar();
+
+    refreshMedicineCatalog();
+    const Medicine* medicine = lookupMedicine(medicineId);
+    if (!medicine) {
+        printf("Medicine with ID %d not found.\n", medicineId);
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+
+    printf("Current reorder point: %d\n", getReorderPoint(medicineId));
+    printf("Enter new reorder point (0 for none): ");
+    scanf("%d", &reorderPoint);
+    getchar();
+    putReorderPoint(medicineId, reorderPoint > 0 ? reorderPoint : 0);
+
+    FILE *fp = fopen(MEDICINE_REORDER_FILE, "w");
+    if (!fp) {
+        printf("Error accessing files.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+    for (int i = 0; i < reorderCount; i++) {
+        if (reorderLevels[i] > 0) fprintf(fp, "%d,%d\n", reorderMedicineIds[i], reorderLevels[i]);
+    }
+    fclose(fp);
+
+    printf("Reorder point for %s set to %d.\n", medicine->name, reorderPoint > 0 ? reorderPoint : 0);
+    printf("Press Enter to return to menu...");
+    getchar();
+}
+
 void updateMedicineStock() {
-    int medicineId, newQuantity;
+    int medicineId, movementChoice, quantity;
     printf("Enter Medicine ID to update stock: ");
     scanf("%d", &medicineId);
     getchar();
 
+    refreshMedicineCatalog();
     Medicine medicine = findMedicine(medicineId);
     if (medicine.medicineId == 0) {
         printf("Medicine with ID %d not found.\n", medicineId);
@@ -266,57 +986,87 @@ void updateMedicineStock() {
 
     showMedicine(&medicine);
     printf("Current quantity: %d\n", medicine.quantity);
-    printf("Enter new quantity: ");
-    scanf("%d", &newQuantity);
+    printf("\n1. Receive stock\n");
+    printf("2. Adjust to counted quantity\n");
+    printf("3. Remove expired stock\n");
+    printf("Enter movement type: ");
+    scanf("%d", &movementChoice);
     getchar();
 
-    // Update the file by rewriting it
-    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
-    FILE *temp = fopen("data/temp_medicine.csv", "w");
+    if (movementChoice < 1 || movementChoice > 3) {
+        printf("Invalid movement type.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+
+    printf(movementChoice == 2 ? "Enter counted quantity: " : "Enter quantity: ");
+    scanf("%d", &quantity);
+    getchar();
+
+    if (quantity < 0 || (movementChoice != 2 && quantity == 0)) {
+        printf("Invalid quantity.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
 
-    if (!fp || !temp) {
+    // Work from the stock on hand now, which other terminals may have
+    // dispensed from while the prompts were open
+    FILE *ledger = openStockLedger();
+    if (!ledger) {
         printf("Error accessing files.\n");
-        if (fp) fclose(fp);
-        if (temp) fclose(temp);
         printf("Press Enter to return to menu...");
         getchar();
         return;
     }
+    syncStockLedger(ledger);
 
-    Medicine currentMedicine;
-    while (fscanf(fp, "%d,%49[^,],%29[^,],%d,%f,%11[^,],%49[^,],%199[^\n]",
-                  &currentMedicine.medicineId, currentMedicine.name, currentMedicine.category,
-                  &currentMedicine.quantity, &currentMedicine.price, currentMedicine.expiryDate,
-                  &currentMedicine.manufacturer, currentMedicine.description) == 8) {
+    int row;
+    if (!intMapGet(&catalogIndex, medicineId, &row)) {
+        closeStockLedger(ledger);
+        printf("Medicine with ID %d not found.\n", medicineId);
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
 
-        if (currentMedicine.medicineId == medicineId) {
-            // Write updated record
-            fprintf(temp, "%d,%s,%s,%d,%.2f,%s,%s,%s\n",
-                    currentMedicine.medicineId, currentMedicine.name, currentMedicine.category,
-                    newQuantity, currentMedicine.price, currentMedicine.expiryDate,
-                    currentMedicine.manufacturer, currentMedicine.description);
-        } else {
-            // Write original record
-            fprintf(temp, "%d,%s,%s,%d,%.2f,%s,%s,%s\n",
-                    currentMedicine.medicineId, currentMedicine.name, currentMedicine.category,
-                    currentMedicine.quantity, currentMedicine.price, currentMedicine.expiryDate,
-                    currentMedicine.manufacturer, currentMedicine.description);
-        }
+    const int previousQuantity = catalog[row].quantity;
+    if (movementChoice == 3 && quantity > previousQuantity) {
+        closeStockLedger(ledger);
+        printf("Only %d in stock, cannot remove %d.\n", previousQuantity, quantity);
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
     }
 
-    fclose(fp);
-    fclose(temp);
+    int isRecorded = 1;
+    if (movementChoice == 1) {
+        isRecorded = recordStockMovement(ledger, STOCK_RECEIPT, row, quantity);
+    } else if (movementChoice == 2) {
+        if (quantity != previousQuantity) {
+            isRecorded = recordStockMovement(ledger, STOCK_ADJUSTMENT, row, quantity - previousQuantity);
+        }
+    } else {
+        isRecorded = recordStockMovement(ledger, STOCK_EXPIRY, row, -quantity);
+    }
+    const int newQuantity = catalog[row].quantity;
+    closeStockLedger(ledger);
 
-    // Replace original file with updated file
-    remove(MEDICINE_DATAFILE);
-    rename("data/temp_medicine.csv", MEDICINE_DATAFILE);
+    if (!isRecorded) {
+        printf("Error accessing files.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
 
-    printf("Stock updated successfully from %d to %d.\n", medicine.quantity, newQuantity);
+    printf("Stock updated successfully from %d to %d.\n", previousQuantity, newQuantity);
     printf("Press Enter to return to menu...");
     getchar();
 }
 
 void deleteMedicine(const int medicineId) {
+    refreshMedicineCatalog();
     Medicine medicine = findMedicine(medicineId);
     if (medicine.medicineId == 0) {
         printf("Medicine with ID %d not found.\n", medicineId);
@@ -338,78 +1088,397 @@ void deleteMedicine(const int medicineId) {
         return;
     }
 
-    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
-    FILE *temp = fopen("data/temp_medicine.csv", "w");
+    FILE *ledger = openStockLedger();
+    if (!ledger) {
+        printf("Error accessing files.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+    syncStockLedger(ledger);
 
-    if (!fp || !temp) {
+    // Only keep records that don't match the ID to delete
+    int kept = 0;
+    for (int i = 0; i < catalogCount; i++) {
+        if (catalog[i].medicineId != medicineId) catalog[kept++] = catalog[i];
+    }
+    catalogCount = kept;
+    rebuildCatalogIndex();
+
+    const int isWritten = writeMedicineCatalog(ledger);
+    closeStockLedger(ledger);
+    if (!isWritten) {
         printf("Error accessing files.\n");
-        if (fp) fclose(fp);
-        if (temp) fclose(temp);
+        invalidateMedicineCatalog();
         printf("Press Enter to return to menu...");
         getchar();
         return;
     }
 
-    Medicine currentMedicine;
-    while (fscanf(fp, "%d,%49[^,],%29[^,],%d,%f,%11[^,],%49[^,],%199[^\n]",
-                  &currentMedicine.medicineId, currentMedicine.name, currentMedicine.category,
-                  &currentMedicine.quantity, &currentMedicine.price, currentMedicine.expiryDate,
-                  currentMedicine.manufacturer, currentMedicine.description) == 8) {
+    printf("Medicine deleted successfully.\n");
+    printf("Press Enter to return to menu...");
+    getchar();
+}
+
+static int isInteractiveInput() {
+#ifdef _WIN32
+    return _isatty(_fileno(stdin));
+#else
+    return isatty(STDIN_FILENO);
+#endif
+}
+
+// One keypress, without waiting for Enter or echoing it
+static int readKeypress() {
+#ifdef _WIN32
+    return _getch();
+#else
+    struct termios saved, raw;
+    tcgetattr(STDIN_FILENO, &saved);
+    raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    const int key = getchar();
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    return key;
+#endif
+}
+
+static void clearSearchScreen() {
+#ifdef _WIN32
+    system("cls");
+#else
+    printf("\033[H\033[J");
+#endif
+}
+
+// Redraw the best matches after every keypress. Returns how many matches
+// the final query has, or -1 if the search was cancelled.
+static int searchMedicineAsYouType(char* query, const size_t size, const Medicine** results) {
+    size_t length = 0;
+    int found = 0;
+    query[0] = '\0';
+
+    while (1) {
+        clearSearchScreen();
+        printf("==== Search Medicine ====\n");
+        printf("Type a name or manufacturer. Enter shows details, Esc cancels.\n\n");
+        printf("Search: %s\n\n", query);
+        if (length > 0) {
+            printf("%-5s %-20s %-20s %-8s\n", "ID", "Name", "Manufacturer", "Quantity");
+            printf("------------------------------------------------------\n");
+            for (int i = 0; i < found; i++) {
+                printf("%-5d %-20s %-20s %-8d\n", results[i]->medicineId, results[i]->name,
+                       results[i]->manufacturer, results[i]->quantity);
+            }
+            if (found == 0) printf("No matches.\n");
+        }
+        fflush(stdout);
+
+        const int key = readKeypress();
+        if (key == EOF || key == 27) return -1;
+        if (key == '\n' || key == '\r') return found;
+
+        if (key == 127 || key == 8) {
+            if (length > 0) query[--length] = '\0';
+        } else if (isprint(key) && length < size - 1) {
+            query[length++] = (char)key;
+            query[length] = '\0';
+        } else {
+            continue;
+        }
+        found = length > 0 ? searchMedicines(query, results, MEDICINE_SEARCH_RESULTS) : 0;
+    }
+}
+
+void searchMedicine() {
+    char searchName[50];
+    refreshMedicineCatalog();
 
-        // Only write records that don't match the ID to delete
-        if (currentMedicine.medicineId != medicineId) {
-            fprintf(temp, "%d,%s,%s,%d,%.2f,%s,%s,%s\n",
-                    currentMedicine.medicineId, currentMedicine.name, currentMedicine.category,
-                    currentMedicine.quantity, currentMedicine.price, currentMedicine.expiryDate,
-                    currentMedicine.manufacturer, currentMedicine.description);
+    int count;
+    getMedicineCatalog(&count);
+    const Medicine** results = malloc(sizeof(Medicine*) * (count > MEDICINE_SEARCH_RESULTS ? count : MEDICINE_SEARCH_RESULTS));
+
+    int found;
+    if (isInteractiveInput()) {
+        found = searchMedicineAsYouType(searchName, sizeof(searchName), results);
+        if (found < 0) {
+            free(results);
+            return;
         }
+        printf("\n");
+    } else {
+        printf("Enter medicine name to search: ");
+        fgets(searchName, sizeof(searchName), stdin);
+        stripMedicineNewline(searchName);
+        found = searchMedicines(searchName, results, count);
     }
 
-    fclose(fp);
-    fclose(temp);
+    printf("\n==== Search Results ====\n");
+    for (int i = 0; i < found; i++) {
+        Medicine medicine = *results[i];
+        showMedicine(&medicine);
+    }
+    free(results);
 
-    // Replace original file with updated file
-    remove(MEDICINE_DATAFILE);
-    rename("data/temp_medicine.csv", MEDICINE_DATAFILE);
+    if (found == 0) {
+        printf("No medicines found matching '%s'.\n", searchName);
+    }
 
-    printf("Medicine deleted successfully.\n");
     printf("Press Enter to return to menu...");
     getchar();
 }
 
-void searchMedicine() {
-    char searchName[50];
-    printf("Enter medicine name to search: ");
-    fgets(searchName, sizeof(searchName), stdin);
-    stripMedicineNewline(searchName);
+static void printStockMovement(const StockMovement* movement, void* context) {
+    const int* medicineId = context;
+    if (movement->medicineId != *medicineId) return;
 
-    FILE *fp = fopen(MEDICINE_DATAFILE, "r");
+    char when[20];
+    strftime(when, sizeof(when), "%d/%m/%Y %H:%M", localtime(&movement->timestamp));
+    printf("%-17s %-12s %+8d\n", when, getStockMovementTypeString(movement->type), movement->quantity);
+}
+
+// Movements of one medicine over the last N days, found by a time range
+// scan of the ledger, with totals and the average daily consumption
+void showStockMovementHistory() {
+    int medicineId, days;
+    printf("Enter Medicine ID: ");
+    scanf("%d", &medicineId);
+    getchar();
+
+    const Medicine* medicine = lookupMedicine(medicineId);
+    if (!medicine) {
+        printf("Medicine with ID %d not found.\n", medicineId);
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+
+    printf("Number of days to show: ");
+    scanf("%d", &days);
+    getchar();
+    if (days <= 0) days = 30;
+
+    const time_t to = time(NULL) + 1;
+    const time_t from = to - (time_t)days * 24 * 60 * 60;
+
+    printf("\n==== Stock Movements: %s (last %d days) ====\n", medicine->name, days);
+    printf("%-17s %-12s %8s\n", "Date", "Type", "Quantity");
+    printf("--------------------------------------\n");
+    scanStockMovements(from, to, printStockMovement, &medicineId);
+
+    StockMovementTotals totals;
+    if (getStockMovementTotals(medicineId, from, to, &totals) == 0) {
+        printf("No stock movements in this period.\n");
+    } else {
+        printf("\nReceived: %d  Dispensed: %d  Adjusted: %+d  Expired: %d\n",
+               totals.received, totals.dispensed, totals.adjusted, totals.expired);
+        printf("Average consumption: %.2f units/day\n", (double)totals.dispensed / days);
+    }
+
+    printf("\nPress Enter to return to menu...");
+    getchar();
+}
+
+// Stock that expires within N days, soonest first, with expired stock at the top
+void listExpiringMedicines() {
+    int days;
+    printf("Show medicines expiring within how many days: ");
+    scanf("%d", &days);
+    getchar();
+    if (days < 0) days = 0;
+
+    refreshMedicineCatalog();
+    int count;
+    getMedicineCatalog(&count);
+    const Medicine** medicines = malloc(sizeof(Medicine*) * (count > 0 ? count : 1));
+
+    const int today = getTodayPackedDate();
+    const int found = findExpiringMedicines(addDaysToPackedDate(today, days), medicines, count);
+
+    printf("\n==== Medicines Expiring Within %d Days ====\n", days);
+    printf("%-5s %-20s %-8s %-12s %s\n", "ID", "Name", "Quantity", "Expiry", "Status");
+    printf("--------------------------------------------------------\n");
+
+    for (int i = 0; i < found; i++) {
+        char expiryDate[12];
+        formatExpiryDate(medicines[i]->expiryDate, expiryDate, sizeof(expiryDate));
+        printf("%-5d %-20s %-8d %-12s %s\n", medicines[i]->medicineId, medicines[i]->name,
+               medicines[i]->quantity, expiryDate, medicines[i]->expiryDate < today ? "EXPIRED" : "Expiring");
+    }
+    free(medicines);
+
+    if (found == 0) {
+        printf("No stock expires within %d days.\n", days);
+    }
+
+    printf("\nPress Enter to return to menu...");
+    getchar();
+}
+
+// Pick a category from its facet counts, then narrow it by stock level and
+// expiry, e.g. antibiotics with under 20 units expiring within 90 days
+void browseMedicineCategories() {
+    char buffer[32];
+    refreshMedicineCatalog();
+
+    int count;
+    getMedicineCatalog(&count);
+    CategoryFacet* facets = malloc(sizeof(CategoryFacet) * (count > 0 ? count : 1));
+    const int facetCount = getCategoryFacets(facets, count);
+    if (facetCount == 0) {
+        free(facets);
+        printf("No medicines found in inventory.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+
+    printf("\n==== Categories ====\n");
+    for (int i = 0; i < facetCount; i++) {
+        printf("%2d. %-20s %4d medicines %7d units\n", i + 1, facets[i].name,
+               facets[i].medicineCount, facets[i].unitsInStock);
+    }
+
+    getMedicineInput("\nCategory number: ", buffer, sizeof(buffer));
+    const int choice = atoi(buffer);
+    if (choice < 1 || choice > facetCount) {
+        free(facets);
+        printf("Invalid category.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+    char category[30];
+    strncpy(category, facets[choice - 1].name, sizeof(category) - 1);
+    category[sizeof(category) - 1] = '\0';
+    free(facets);
+
+    getMedicineInput("Only stock below (blank for any): ", buffer, sizeof(buffer));
+    const int belowStock = atoi(buffer);
+    getMedicineInput("Only expiring within days (blank for any): ", buffer, sizeof(buffer));
+    const int days = atoi(buffer);
+    const int expiringBy = isMedicineEffectivelyEmpty(buffer) ? 0 : addDaysToPackedDate(getTodayPackedDate(), days);
+
+    const Medicine** medicines = malloc(sizeof(Medicine*) * (count > 0 ? count : 1));
+    const int found = findCategoryMedicines(category, belowStock, expiringBy, medicines, count);
+
+    printf("\n==== %s ====\n", category);
+    printf("%-5s %-20s %-8s %-12s\n", "ID", "Name", "Quantity", "Expiry");
+    printf("----------------------------------------------\n");
+    for (int i = 0; i < found; i++) {
+        char expiryDate[12];
+        formatExpiryDate(medicines[i]->expiryDate, expiryDate, sizeof(expiryDate));
+        printf("%-5d %-20s %-8d %-12s\n", medicines[i]->medicineId, medicines[i]->name,
+               medicines[i]->quantity, expiryDate);
+    }
+    free(medicines);
+
+    if (found == 0) {
+        printf("No medicines match.\n");
+    }
+
+    printf("\nPress Enter to return to menu...");
+    getchar();
+}
+
+// Receive a supplier delivery from a CSV of "medicineId,quantity" lines.
+// Every line is checked against the catalog first; if any is wrong nothing
+// is received. Otherwise all receipts go to the ledger in one write under
+// one lock, so other terminals see the whole delivery or none of it.
+void receiveShipment() {
+    char path[256];
+    getMedicineInput("Shipment file path: ", path, sizeof(path));
+
+    FILE *fp = fopen(path, "r");
     if (!fp) {
-        printf("No medicine data file found.\n");
+        printf("Unable to open shipment file '%s'.\n", path);
         printf("Press Enter to return to menu...");
         getchar();
         return;
     }
 
-    Medicine medicine;
-    int found = 0;
-    printf("\n==== Search Results ====\n");
+    int* medicineIds = NULL;
+    int* quantities = NULL;
+    int* lineNumbers = NULL;
+    int lineCount = 0, lineCapacity = 0, badLines = 0, lineNumber = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        lineNumber++;
+        if (isMedicineEffectivelyEmpty(line)) continue;
+
+        int medicineId, quantity;
+        if (sscanf(line, "%d,%d", &medicineId, &quantity) != 2) {
+            // A header row is allowed at the top
+            if (lineNumber == 1 && !isdigit((unsigned char)line[0])) continue;
+            printf("Line %d: expected medicineId,quantity\n", lineNumber);
+            badLines++;
+            continue;
+        }
+        if (quantity <= 0) {
+            printf("Line %d: quantity must be positive\n", lineNumber);
+            badLines++;
+            continue;
+        }
 
-    while (fscanf(fp, "%d,%49[^,],%29[^,],%d,%f,%11[^,],%49[^,],%199[^\n]",
-                  &medicine.medicineId, medicine.name, medicine.category,
-                  &medicine.quantity, &medicine.price, medicine.expiryDate,
-                  medicine.manufacturer, medicine.description) == 8) {
-        if (strstr(medicine.name, searchName) != NULL) {
-            showMedicine(&medicine);
-            found = 1;
+        if (lineCount == lineCapacity) {
+            lineCapacity = lineCapacity ? lineCapacity * 2 : 64;
+            medicineIds = realloc(medicineIds, sizeof(int) * lineCapacity);
+            quantities = realloc(quantities, sizeof(int) * lineCapacity);
+            lineNumbers = realloc(lineNumbers, sizeof(int) * lineCapacity);
         }
+        medicineIds[lineCount] = medicineId;
+        quantities[lineCount] = quantity;
+        lineNumbers[lineCount] = lineNumber;
+        lineCount++;
     }
+    fclose(fp);
 
-    if (!found) {
-        printf("No medicines found matching '%s'.\n", searchName);
+    FILE *ledger = openStockLedger();
+    if (!ledger) {
+        free(medicineIds);
+        free(quantities);
+        free(lineNumbers);
+        printf("Error accessing files.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+    syncStockLedger(ledger);
+    isCatalogLoaded = 1;
+
+    // Resolve every line to a catalog row while holding the lock, so no
+    // medicine can be deleted between the check and the write
+    int* rows = malloc(sizeof(int) * (lineCount > 0 ? lineCount : 1));
+    for (int i = 0; i < lineCount; i++) {
+        if (!intMapGet(&catalogIndex, medicineIds[i], &rows[i])) {
+            printf("Line %d: medicine ID %d is not in the catalog\n", lineNumbers[i], medicineIds[i]);
+            badLines++;
+        }
     }
 
-    fclose(fp);
+    int isRecorded = 0, units = 0;
+    if (badLines == 0 && lineCount > 0) {
+        isRecorded = recordStockMovements(ledger, STOCK_RECEIPT, rows, quantities, lineCount);
+        for (int i = 0; i < lineCount; i++) units += quantities[i];
+    }
+    closeStockLedger(ledger);
+    free(rows);
+    free(medicineIds);
+    free(quantities);
+    free(lineNumbers);
+
+    if (badLines > 0) {
+        printf("\n%d line(s) rejected. No stock was received.\n", badLines);
+    } else if (lineCount == 0) {
+        printf("The shipment file has no lines to receive.\n");
+    } else if (!isRecorded) {
+        printf("Error accessing files. No stock was received.\n");
+    } else {
+        printf("Received %d units on %d line(s).\n", units, lineCount);
+    }
     printf("Press Enter to return to menu...");
     getchar();
 }
@@ -427,7 +1496,12 @@ void medicineInventoryLookup() {
         printf("4. Update Stock\n");
         printf("5. Low Stock Alert\n");
         printf("6. Delete Medicine\n");
-        printf("7. Back to Main Menu\n");
+        printf("7. Stock Movement History\n");
+        printf("8. Expiry Alert\n");
+        printf("9. Set Reorder Point\n");
+        printf("10. Browse by Category\n");
+        printf("11. Receive Shipment\n");
+        printf("12. Back to Main Menu\n");
         printf("\nChoice: ");
 
         if (scanf("%d", &choice) != 1) {
@@ -464,6 +1538,21 @@ void medicineInventoryLookup() {
                 break;
             }
             case 7:
+                showStockMovementHistory();
+                break;
+            case 8:
+                listExpiringMedicines();
+                break;
+            case 9:
+                setMedicineReorderPoint();
+                break;
+            case 10:
+                browseMedicineCategories();
+                break;
+            case 11:
+                receiveShipment();
+                break;
+            case 12:
                 return;
             default:
                 printf("Invalid choice. Press Enter to continue...");
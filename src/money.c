@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <ctype.h>
+#include "money.h"
+
+// Read "123", "123.4" or "123.45" taka (sign optional) into paisa, rounding
+// any further digits half away from zero. Returns 0 if there are no digits.
+int parseMoney(const char* text, Money* amount) {
+    if (!text) return 0;
+    while (isspace((unsigned char)*text)) text++;
+
+    const int isNegative = *text == '-';
+    if (*text == '-' || *text == '+') text++;
+
+    Money value = 0;
+    int digits = 0;
+    for (; isdigit((unsigned char)*text); text++, digits++) {
+        value = value * 10 + (*text - '0');
+    }
+    value *= MONEY_SCALE;
+
+    if (*text == '.') {
+        text++;
+        Money scale = MONEY_SCALE / 10;
+        for (; isdigit((unsigned char)*text); text++, digits++) {
+            if (scale > 0) {
+                value += (*text - '0') * scale;
+                scale /= 10;
+            } else {
+                // First digit past the paisa decides the rounding
+                if (*text >= '5') value++;
+                while (isdigit((unsigned char)text[1])) text++;
+            }
+        }
+    }
+    if (digits == 0) return 0;
+
+    *amount = isNegative ? -value : value;
+    return 1;
+}
+
+void formatMoney(const Money amount, char* text, const size_t size) {
+    const Money magnitude = amount < 0 ? -amount : amount;
+    snprintf(text, size, "%s%lld.%02d", amount < 0 ? "-" : "",
+             (long long)(magnitude / MONEY_SCALE), (int)(magnitude % MONEY_SCALE));
+}
+
+// Four independent running sums so the adds do not wait on each other and
+// the compiler is free to use vector registers; integer addition gives the
+// same total whichever way it is split.
+Money sumMoney(const Money* amounts, const int count) {
+    Money sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        sum0 += amounts[i];
+        sum1 += amounts[i + 1];
+        sum2 += amounts[i + 2];
+        sum3 += amounts[i + 3];
+    }
+    for (; i < count; i++) {
+        sum0 += amounts[i];
+    }
+    return sum0 + sum1 + sum2 + sum3;
+}
+
+// Add each amount into totals[groups[i]]. Callers size and zero `totals`
+// for every group number used.
+void sumMoneyByGroup(const int* groups, const Money* amounts, const int count, Money* totals) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        totals[groups[i]] += amounts[i];
+        totals[groups[i + 1]] += amounts[i + 1];
+        totals[groups[i + 2]] += amounts[i + 2];
+        totals[groups[i + 3]] += amounts[i + 3];
+    }
+    for (; i < count; i++) {
+        totals[groups[i]] += amounts[i];
+    }
+}
@@ -8,12 +8,20 @@
 #include <ctype.h>
 #include "prescription.h"
 #include "medicine.h"
+#include "consumption_forecast.h"
 
 #define PRESCRIPTION_DATAFILE "data/prescription.csv"
 
 static int maxPrescriptionId = 3000;
 static int isMaxPrescriptionIdInitialized = 0;
 
+// patientId (column 1) -> prescription rows
+static RowIndex prescriptionPatientIndex = { .path = PRESCRIPTION_DATAFILE, .keyColumn = 1 };
+
+RowIndex* getPrescriptionPatientIndex() {
+    return &prescriptionPatientIndex;
+}
+
 // Helper function to check if a string is effectively empty
 static int isPrescriptionEffectivelyEmpty(const char* str) {
     if (!str) return 1;
@@ -64,12 +72,10 @@ void initializeMaxPrescriptionId() {
     }
 
     Prescription prescription;
+    char line[1024];
     maxPrescriptionId = 3000;
-    while (fscanf(fp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
-                  &prescription.prescriptionId, &prescription.patientId, &prescription.medicineId,
-                  prescription.medicineName, &prescription.quantity, &prescription.unitPrice,
-                  &prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                  prescription.dosage, prescription.duration, prescription.notes) == 12) {
+    while (fgets(line, sizeof(line), fp)) {
+        if (!parsePrescriptionLine(line, &prescription)) continue;
         if (prescription.prescriptionId > maxPrescriptionId) {
             maxPrescriptionId = prescription.prescriptionId;
         }
@@ -78,6 +84,27 @@ void initializeMaxPrescriptionId() {
     isMaxPrescriptionIdInitialized = 1;
 }
 
+int parsePrescriptionLine(const char* line, Prescription* prescription) {
+    char unitPrice[MONEY_TEXT_SIZE], totalPrice[MONEY_TEXT_SIZE];
+    return sscanf(line, "%d,%d,%d,%49[^,],%d,%23[^,],%23[^,],%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
+                  &prescription->prescriptionId, &prescription->patientId, &prescription->medicineId,
+                  prescription->medicineName, &prescription->quantity, unitPrice,
+                  totalPrice, prescription->prescribedDate, prescription->prescribedBy,
+                  prescription->dosage, prescription->duration, prescription->notes) == 12 &&
+           parseMoney(unitPrice, &prescription->unitPrice) && parseMoney(totalPrice, &prescription->totalPrice);
+}
+
+static void writePrescriptionRecord(FILE* fp, const Prescription* prescription) {
+    char unitPrice[MONEY_TEXT_SIZE], totalPrice[MONEY_TEXT_SIZE];
+    formatMoney(prescription->unitPrice, unitPrice, sizeof(unitPrice));
+    formatMoney(prescription->totalPrice, totalPrice, sizeof(totalPrice));
+    fprintf(fp, "%d,%d,%d,%s,%d,%s,%s,%s,%s,%s,%s,%s\n",
+            prescription->prescriptionId, prescription->patientId, prescription->medicineId,
+            prescription->medicineName, prescription->quantity, unitPrice,
+            totalPrice, prescription->prescribedDate, prescription->prescribedBy,
+            prescription->dosage, prescription->duration, prescription->notes);
+}
+
 int generatePrescriptionId() {
     if (!isMaxPrescriptionIdInitialized) {
         initializeMaxPrescriptionId();
@@ -85,22 +112,60 @@ int generatePrescriptionId() {
     return ++maxPrescriptionId;
 }
 
-void savePrescription(Prescription* prescription) {
+// Returns 0 if the record could not be written
+int savePrescription(Prescription* prescription) {
     createDataDirectory();
 
     FILE *fp = fopen(PRESCRIPTION_DATAFILE, "a");
     if (!fp) {
         printf("Error saving prescription.\n");
-        return;
+        return 0;
     }
 
-    fprintf(fp, "%d,%d,%d,%s,%d,%.2f,%.2f,%s,%s,%s,%s,%s\n",
-            prescription->prescriptionId, prescription->patientId, prescription->medicineId,
-            prescription->medicineName, prescription->quantity, prescription->unitPrice,
-            prescription->totalPrice, prescription->prescribedDate, prescription->prescribedBy,
-            prescription->dosage, prescription->duration, prescription->notes);
+    fseek(fp, 0, SEEK_END);
+    const long rowOffset = ftell(fp);
+    writePrescriptionRecord(fp, prescription);
+    const long rowEnd = ftell(fp);
 
-    fclose(fp);
+    const int isWritten = !ferror(fp);
+    if (fclose(fp) != 0 || !isWritten) {
+        printf("Error saving prescription.\n");
+        invalidateRowIndex(&prescriptionPatientIndex);
+        return 0;
+    }
+    noteRowAppended(&prescriptionPatientIndex, prescription->patientId, rowOffset, rowEnd);
+    return 1;
+}
+
+// Post a stock change for a prescription: positive returns units, negative
+// takes more. A medicine no longer in inventory has no stock to adjust.
+// Returns 0 if the units are not available.
+static int postPrescriptionStock(const int medicineId, const int change) {
+    int available;
+    if (adjustMedicineStock(medicineId, change, &available)) return 1;
+    if (available < 0) {
+        printf("Medicine %d is no longer in inventory, stock not adjusted.\n", medicineId);
+        return 1;
+    }
+
+    if (change > 0) {
+        printf("Could not return %d units of medicine %d to stock.\n", change, medicineId);
+    } else {
+        printf("Insufficient stock! Only %d available.\n", available);
+    }
+    return 0;
+}
+
+// Move stock from what `before` dispensed to what `after` dispenses. Swap
+// the arguments to undo it. Returns 0, changing nothing, if there is not
+// enough stock.
+static int movePrescriptionStock(const Prescription* before, const Prescription* after) {
+    if (before->medicineId == after->medicineId) {
+        return postPrescriptionStock(after->medicineId, before->quantity - after->quantity);
+    }
+    if (!postPrescriptionStock(after->medicineId, -after->quantity)) return 0;
+    postPrescriptionStock(before->medicineId, before->quantity);
+    return 1;
 }
 
 void addPrescription() {
@@ -150,14 +215,18 @@ void addPrescription() {
         }
 
         // Get medicine details
-        const Medicine medicine = findMedicine(prescription.medicineId);
-        if (medicine.medicineId == 0) {
+        const Medicine requested = findMedicine(prescription.medicineId);
+        if (requested.medicineId == 0) {
             printf("Medicine not found! Skipping this medicine.\n");
             printf("Press Enter to continue...");
             getchar();
             continue;
         }
 
+        // Dispense from the lot that expires first
+        const Medicine medicine = chooseMedicineLot(&requested);
+        prescription.medicineId = medicine.medicineId;
+
         strcpy(prescription.medicineName, medicine.name);
         prescription.unitPrice = medicine.price;
 
@@ -171,6 +240,15 @@ void addPrescription() {
             continue;
         }
 
+        // Take the units out of stock now, so another terminal cannot hand them out
+        int available;
+        if (!reserveMedicineStock(prescription.medicineId, prescription.quantity, &available)) {
+            printf("Insufficient stock! Only %d available. Skipping this medicine.\n", available < 0 ? 0 : available);
+            printf("Press Enter to continue...");
+            getchar();
+            continue;
+        }
+
         prescription.totalPrice = prescription.quantity * prescription.unitPrice;
 
         // Dosage
@@ -191,13 +269,21 @@ void addPrescription() {
         const struct tm *timeinfo = localtime(&now);
         strftime(prescription.prescribedDate, sizeof(prescription.prescribedDate), "%d/%m/%Y", timeinfo);
 
-        savePrescription(&prescription);
+        // Nothing was prescribed, so put the reserved units back
+        if (!savePrescription(&prescription)) {
+            postPrescriptionStock(prescription.medicineId, prescription.quantity);
+            printf("Press Enter to continue...");
+            getchar();
+            continue;
+        }
 
         printf("Medicine prescribed successfully!\n");
         printf("Prescription ID: %d\n", prescription.prescriptionId);
         printf("Medicine: %s\n", prescription.medicineName);
         printf("Quantity: %d\n", prescription.quantity);
-        printf("Total cost: Tk.%.2f\n", prescription.totalPrice);
+        char totalPrice[MONEY_TEXT_SIZE];
+        formatMoney(prescription.totalPrice, totalPrice, sizeof(totalPrice));
+        printf("Total cost: Tk.%s\n", totalPrice);
 
         // Ask if user wants to add another medicine
         do {
@@ -240,17 +326,18 @@ void viewPatientPrescriptions() {
 
     Prescription prescription;
     int found = 0;
-
-    while (fscanf(fp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
-                  &prescription.prescriptionId, &prescription.patientId, &prescription.medicineId,
-                  prescription.medicineName, &prescription.quantity, &prescription.unitPrice,
-                  &prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                  prescription.dosage, prescription.duration, prescription.notes) == 12) {
-
-        if (prescription.patientId == patientId) {
-            printf("%-5d %-20s %-4d Tk.%-9.2f Tk.%-9.2f %-12s %-15s\n",
+    char line[1024];
+
+    for (int entry = firstIndexedRow(&prescriptionPatientIndex, patientId); entry >= 0;
+         entry = nextIndexedRow(&prescriptionPatientIndex, entry)) {
+        if (readRowAt(fp, indexedRowOffset(&prescriptionPatientIndex, entry), line, sizeof(line)) &&
+            parsePrescriptionLine(line, &prescription) && prescription.patientId == patientId) {
+            char unitPrice[MONEY_TEXT_SIZE], totalPrice[MONEY_TEXT_SIZE];
+            formatMoney(prescription.unitPrice, unitPrice, sizeof(unitPrice));
+            formatMoney(prescription.totalPrice, totalPrice, sizeof(totalPrice));
+            printf("%-5d %-20s %-4d Tk.%-9s Tk.%-9s %-12s %-15s\n",
                    prescription.prescriptionId, prescription.medicineName, prescription.quantity,
-                   prescription.unitPrice, prescription.totalPrice, prescription.prescribedDate,
+                   unitPrice, totalPrice, prescription.prescribedDate,
                    prescription.prescribedBy);
             found = 1;
         }
@@ -280,15 +367,16 @@ void viewAllPrescriptions() {
     printf("--------------------------------------------------------------------------------\n");
 
     Prescription prescription;
-    while (fscanf(fp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
-                  &prescription.prescriptionId, &prescription.patientId, &prescription.medicineId,
-                  prescription.medicineName, &prescription.quantity, &prescription.unitPrice,
-                  &prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                  prescription.dosage, prescription.duration, prescription.notes) == 12) {
-
-        printf("%-5d %-10d %-20s %-4d Tk.%-9.2f Tk.%-9.2f %-12s\n",
+    char line[1024];
+    while (fgets(line, sizeof(line), fp)) {
+        if (!parsePrescriptionLine(line, &prescription)) continue;
+
+        char unitPrice[MONEY_TEXT_SIZE], totalPrice[MONEY_TEXT_SIZE];
+        formatMoney(prescription.unitPrice, unitPrice, sizeof(unitPrice));
+        formatMoney(prescription.totalPrice, totalPrice, sizeof(totalPrice));
+        printf("%-5d %-10d %-20s %-4d Tk.%-9s Tk.%-9s %-12s\n",
                prescription.prescriptionId, prescription.patientId, prescription.medicineName,
-               prescription.quantity, prescription.unitPrice, prescription.totalPrice,
+               prescription.quantity, unitPrice, totalPrice,
                prescription.prescribedDate);
     }
 
@@ -304,12 +392,9 @@ Prescription findPrescriptionById(const int prescriptionId) {
         return prescription;
     }
 
-    while (fscanf(fp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
-                  &prescription.prescriptionId, &prescription.patientId, &prescription.medicineId,
-                  prescription.medicineName, &prescription.quantity, &prescription.unitPrice,
-                  &prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                  prescription.dosage, prescription.duration, prescription.notes) == 12) {
-
+    char line[1024];
+    while (fgets(line, sizeof(line), fp)) {
+        if (!parsePrescriptionLine(line, &prescription)) continue;
         if (prescription.prescriptionId == prescriptionId) {
             fclose(fp);
             return prescription;
@@ -322,13 +407,14 @@ Prescription findPrescriptionById(const int prescriptionId) {
 }
 
 void editPrescription(const int prescriptionId) {
-    Prescription prescription = findPrescriptionById(prescriptionId);
-    if (prescription.prescriptionId == 0) {
+    const Prescription original = findPrescriptionById(prescriptionId);
+    if (original.prescriptionId == 0) {
         printf("Prescription with ID %d not found.\n", prescriptionId);
         printf("Press Enter to return to menu...");
         getchar();
         return;
     }
+    Prescription prescription = original;
 
     char buffer[256];
     char prompt[256];
@@ -363,8 +449,13 @@ void editPrescription(const int prescriptionId) {
     snprintf(prompt, sizeof(prompt), "Quantity [%d]: ", prescription.quantity);
     getPrescriptionInput(prompt, buffer, sizeof(buffer));
     if (!isPrescriptionEffectivelyEmpty(buffer)) {
-        prescription.quantity = atoi(buffer);
-        prescription.totalPrice = prescription.quantity * prescription.unitPrice;
+        const int quantity = atoi(buffer);
+        if (quantity > 0) {
+            prescription.quantity = quantity;
+            prescription.totalPrice = prescription.quantity * prescription.unitPrice;
+        } else {
+            printf("Invalid quantity, keeping original quantity.\n");
+        }
     }
 
     // Prescribed by
@@ -408,28 +499,28 @@ void editPrescription(const int prescriptionId) {
         return;
     }
 
+    // Dispense or return the difference before the record changes
+    if (!movePrescriptionStock(&original, &prescription)) {
+        fclose(fp);
+        fclose(temp);
+        remove("data/temp_prescription.csv");
+        printf("Prescription not updated.\n");
+        printf("Press Enter to return to menu...");
+        getchar();
+        return;
+    }
+
     Prescription currentPrescription;
+    char line[1024];
     int found = 0;
 
-    while (fscanf(fp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
-                  &currentPrescription.prescriptionId, &currentPrescription.patientId, &currentPrescription.medicineId,
-                  currentPrescription.medicineName, &currentPrescription.quantity, &currentPrescription.unitPrice,
-                  &currentPrescription.totalPrice, currentPrescription.prescribedDate, currentPrescription.prescribedBy,
-                  currentPrescription.dosage, currentPrescription.duration, currentPrescription.notes) == 12) {
-
+    while (fgets(line, sizeof(line), fp)) {
+        if (!parsePrescriptionLine(line, &currentPrescription)) continue;
         if (currentPrescription.prescriptionId == prescriptionId) {
             found = 1;
-            fprintf(temp, "%d,%d,%d,%s,%d,%.2f,%.2f,%s,%s,%s,%s,%s\n",
-                    prescription.prescriptionId, prescription.patientId, prescription.medicineId,
-                    prescription.medicineName, prescription.quantity, prescription.unitPrice,
-                    prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                    prescription.dosage, prescription.duration, prescription.notes);
+            writePrescriptionRecord(temp, &prescription);
         } else {
-            fprintf(temp, "%d,%d,%d,%s,%d,%.2f,%.2f,%s,%s,%s,%s,%s\n",
-                    currentPrescription.prescriptionId, currentPrescription.patientId, currentPrescription.medicineId,
-                    currentPrescription.medicineName, currentPrescription.quantity, currentPrescription.unitPrice,
-                    currentPrescription.totalPrice, currentPrescription.prescribedDate, currentPrescription.prescribedBy,
-                    currentPrescription.dosage, currentPrescription.duration, currentPrescription.notes);
+            writePrescriptionRecord(temp, &currentPrescription);
         }
     }
 
@@ -439,9 +530,12 @@ void editPrescription(const int prescriptionId) {
     if (found) {
         remove(PRESCRIPTION_DATAFILE);
         rename("data/temp_prescription.csv", PRESCRIPTION_DATAFILE);
+        invalidateRowIndex(&prescriptionPatientIndex);
+        resetConsumptionForecast();
         printf("Prescription updated successfully.\n");
     } else {
         remove("data/temp_prescription.csv");
+        movePrescriptionStock(&prescription, &original);
         printf("Error updating prescription.\n");
     }
 
@@ -467,22 +561,16 @@ void deletePrescription(const int prescriptionId) {
         return;
     }
 
-    Prescription prescription;
+    Prescription prescription, deleted;
+    char line[1024];
     int found = 0;
 
-    while (fscanf(fp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
-                  &prescription.prescriptionId, &prescription.patientId, &prescription.medicineId,
-                  prescription.medicineName, &prescription.quantity, &prescription.unitPrice,
-                  &prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                  prescription.dosage, prescription.duration, prescription.notes) == 12) {
-
+    while (fgets(line, sizeof(line), fp)) {
+        if (!parsePrescriptionLine(line, &prescription)) continue;
         if (prescription.prescriptionId != prescriptionId) {
-            fprintf(temp, "%d,%d,%d,%s,%d,%.2f,%.2f,%s,%s,%s,%s,%s\n",
-                    prescription.prescriptionId, prescription.patientId, prescription.medicineId,
-                    prescription.medicineName, prescription.quantity, prescription.unitPrice,
-                    prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                    prescription.dosage, prescription.duration, prescription.notes);
+            writePrescriptionRecord(temp, &prescription);
         } else {
+            deleted = prescription;
             found = 1;
         }
     }
@@ -493,6 +581,9 @@ void deletePrescription(const int prescriptionId) {
     if (found) {
         remove(PRESCRIPTION_DATAFILE);
         rename("data/temp_prescription.csv", PRESCRIPTION_DATAFILE);
+        invalidateRowIndex(&prescriptionPatientIndex);
+        resetConsumptionForecast();
+        postPrescriptionStock(deleted.medicineId, deleted.quantity);
         printf("Prescription deleted successfully.\n");
     } else {
         remove("data/temp_prescription.csv");
@@ -517,17 +608,18 @@ void searchPrescriptionByPatient(const int patientId) {
 
     Prescription prescription;
     int found = 0;
-
-    while (fscanf(fp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%49[^,],%99[^,],%49[^,],%199[^\n]",
-                  &prescription.prescriptionId, &prescription.patientId, &prescription.medicineId,
-                  prescription.medicineName, &prescription.quantity, &prescription.unitPrice,
-                  &prescription.totalPrice, prescription.prescribedDate, prescription.prescribedBy,
-                  prescription.dosage, prescription.duration, prescription.notes) == 12) {
-
-        if (prescription.patientId == patientId) {
-            printf("%-5d %-20s %-4d $%-9.2f $%-9.2f %-12s\n",
+    char line[1024];
+
+    for (int entry = firstIndexedRow(&prescriptionPatientIndex, patientId); entry >= 0;
+         entry = nextIndexedRow(&prescriptionPatientIndex, entry)) {
+        if (readRowAt(fp, indexedRowOffset(&prescriptionPatientIndex, entry), line, sizeof(line)) &&
+            parsePrescriptionLine(line, &prescription) && prescription.patientId == patientId) {
+            char unitPrice[MONEY_TEXT_SIZE], totalPrice[MONEY_TEXT_SIZE];
+            formatMoney(prescription.unitPrice, unitPrice, sizeof(unitPrice));
+            formatMoney(prescription.totalPrice, totalPrice, sizeof(totalPrice));
+            printf("%-5d %-20s %-4d $%-9s $%-9s %-12s\n",
                    prescription.prescriptionId, prescription.medicineName, prescription.quantity,
-                   prescription.unitPrice, prescription.totalPrice, prescription.prescribedDate);
+                   unitPrice, totalPrice, prescription.prescribedDate);
             found = 1;
         }
     }
@@ -609,8 +701,11 @@ void prescriptionManagement() {
                         printf("Patient ID: %d\n", prescription.patientId);
                         printf("Medicine: %s (ID: %d)\n", prescription.medicineName, prescription.medicineId);
                         printf("Quantity: %d\n", prescription.quantity);
-                        printf("Unit Price: $%.2f\n", prescription.unitPrice);
-                        printf("Total Price: $%.2f\n", prescription.totalPrice);
+                        char unitPrice[MONEY_TEXT_SIZE], totalPrice[MONEY_TEXT_SIZE];
+                        formatMoney(prescription.unitPrice, unitPrice, sizeof(unitPrice));
+                        formatMoney(prescription.totalPrice, totalPrice, sizeof(totalPrice));
+                        printf("Unit Price: $%s\n", unitPrice);
+                        printf("Total Price: $%s\n", totalPrice);
                         printf("Prescribed Date: %s\n", prescription.prescribedDate);
                         printf("Prescribed By: %s\n", prescription.prescribedBy);
                         printf("Dosage: %s\n", prescription.dosage);
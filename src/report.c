@@ -3,10 +3,16 @@
 #include <string.h>
 #include <time.h>
 #include "report.h"
+#include "billing.h"
 
 #include "medicine.h"
 #include "patient.h"
 #include "prescription.h"
+#include "appointment.h"
+#include "emergency.h"
+#include "timeline.h"
+#include "emergency_medicines.h"
+#include "emergency_records.h"
 
 #define REPORT_DATAFILE "data/reports.csv"
 #define PRESCRIPTION_DATAFILE "data/prescription.csv"
@@ -17,9 +23,7 @@
 
 static int maxReportId = 3000;
 static int maxBillId = 5000;
-
-#define APPOINTMENT_FEE 500.00
-#define EMERGENCY_BASE_FEE 200.00
+static int isMaxBillIdInitialized = 0;
 
 // Helper functions
 static void createReportsDirectory() {
@@ -63,7 +67,25 @@ int generateReportId() {
 }
 
 
+void initializeMaxBillId() {
+    if (isMaxBillIdInitialized) return;
+
+    FILE *fp = fopen(BILL_DATAFILE, "r");
+    if (fp) {
+        char line[512];
+        while (fgets(line, sizeof(line), fp)) {
+            const int id = atoi(line);
+            if (id > maxBillId) maxBillId = id;
+        }
+        fclose(fp);
+    }
+    isMaxBillIdInitialized = 1;
+}
+
 int generateBillId() {
+    if (!isMaxBillIdInitialized) {
+        initializeMaxBillId();
+    }
     return ++maxBillId;
 }
 
@@ -97,14 +119,25 @@ void saveBill(Bill* bill) {
         return;
     }
 
-    fprintf(fp, "%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%s,%s,%s\n",
-            bill->billId, bill->patientId, bill->consultationFee, bill->medicineTotal,
-            bill->tax, bill->discount, bill->grandTotal, bill->billDate,
-            bill->paymentStatus, bill->notes);
-
+    writeBillRecord(fp, bill);
     fclose(fp);
 }
 
+void writeBillRecord(FILE* fp, const Bill* bill) {
+    char consultationFee[MONEY_TEXT_SIZE], emergencyFee[MONEY_TEXT_SIZE], medicineTotal[MONEY_TEXT_SIZE];
+    char tax[MONEY_TEXT_SIZE], discount[MONEY_TEXT_SIZE], grandTotal[MONEY_TEXT_SIZE];
+    formatMoney(bill->consultationFee, consultationFee, sizeof(consultationFee));
+    formatMoney(bill->emergencyFee, emergencyFee, sizeof(emergencyFee));
+    formatMoney(bill->medicineTotal, medicineTotal, sizeof(medicineTotal));
+    formatMoney(bill->tax, tax, sizeof(tax));
+    formatMoney(bill->discount, discount, sizeof(discount));
+    formatMoney(bill->grandTotal, grandTotal, sizeof(grandTotal));
+    fprintf(fp, "%d,%d,%s,%s,%s,%s,%s,%s,%s,%s,%s\n",
+            bill->billId, bill->patientId, consultationFee, emergencyFee, medicineTotal,
+            tax, discount, grandTotal, bill->billDate,
+            bill->paymentStatus, bill->notes);
+}
+
 
 void generateAppointmentHistoryReport() {
     int patientId;
@@ -120,18 +153,20 @@ void generateAppointmentHistoryReport() {
     char content[2000] = "==== APPOINTMENT HISTORY REPORT ====\n\n";
     char line[200];
 
-    FILE *fp = fopen("data/appointment.csv", "r");
+    FILE *fp = fopen(APPOINTMENT_DATAFILE, "r");
     if (!fp) {
         strcat(content, "No appointment data found.\n");
     } else {
         int appointmentCount = 0;
         char buffer[512];
+        RowIndex* index = getAppointmentPatientIndex();
 
-        while (fgets(buffer, sizeof(buffer), fp)) {
+        for (int entry = firstIndexedRow(index, patientId); entry >= 0; entry = nextIndexedRow(index, entry)) {
             int apptId, patId;
             char doctor[50], date[20], time[10], purpose[100], status[20];
 
-            if (sscanf(buffer, "%d,%d,%49[^,],%19[^,],%9[^,],%99[^,],%19[^\n]",
+            if (readRowAt(fp, indexedRowOffset(index, entry), buffer, sizeof(buffer)) &&
+                sscanf(buffer, "%d,%d,%49[^,],%19[^,],%9[^,],%99[^,],%19[^\n]",
                       &apptId, &patId, doctor, date, time, purpose, status) == 7) {
 
                 if (patId == patientId) {
@@ -284,13 +319,28 @@ void generatePatientStatisticsReport() {
     getchar();
 }
 
+// Itemized amounts of one kind, subtotalled once the report is complete
+typedef struct {
+    Money* amounts;
+    int count;
+    int capacity;
+} ChargeList;
+
+static void addReportCharge(ChargeList* charges, const Money amount) {
+    if (charges->count == charges->capacity) {
+        charges->capacity = charges->capacity ? charges->capacity * 2 : 64;
+        charges->amounts = realloc(charges->amounts, sizeof(Money) * charges->capacity);
+    }
+    charges->amounts[charges->count++] = amount;
+}
+
 void generateBillingReport() {
     int patientId;
     char patientIdStr[12];
-    double totalBill = 0.0;
-    double appointmentCharges = 0.0;
-    double emergencyCharges = 0.0;
-    double medicineCharges = 0.0;
+    ChargeList appointmentCharges = {0};
+    ChargeList emergencyCharges = {0};
+    ChargeList medicineCharges = {0};
+    char amount[MONEY_TEXT_SIZE];
 
     system("cls");
     printf("==== Generate Billing Report ====\n\n");
@@ -323,6 +373,10 @@ void generateBillingReport() {
     printf("%-30s %-20s %15s\n", "Description", "Date/Time", "Cost (BDT)");
     printf("--------------------------------------------------------------------------\n");
 
+    // Medicine prices are loaded once up front
+    BillingEngine engine;
+    loadBillingPriceTable(&engine);
+
     // 1. Calculate Appointment Charges
     FILE *appFp = fopen(APPOINTMENT_DATAFILE, "r");
     if (appFp) {
@@ -336,8 +390,9 @@ void generateBillingReport() {
                     snprintf(description, sizeof(description), "Appointment (Dr. %s)", doctorName);
                     char dateTime[30];
                     snprintf(dateTime, sizeof(dateTime), "%s %s", date, time);
-                    printf("%-30s %-20s %15.2f\n", description, dateTime, APPOINTMENT_FEE);
-                    appointmentCharges += APPOINTMENT_FEE;
+                    formatMoney(APPOINTMENT_FEE, amount, sizeof(amount));
+                    printf("%-30s %-20s %15s\n", description, dateTime, amount);
+                    addReportCharge(&appointmentCharges, APPOINTMENT_FEE);
                 }
             }
         }
@@ -348,71 +403,78 @@ void generateBillingReport() {
     FILE *prescFp = fopen(PRESCRIPTION_DATAFILE, "r");
     if (prescFp) {
         Prescription p;
-        while (fscanf(prescFp, "%d,%d,%d,%49[^,],%d,%f,%f,%19[^,],%*s",
-                      &p.prescriptionId, &p.patientId, &p.medicineId, p.medicineName,
-                      &p.quantity, &p.unitPrice, &p.totalPrice, p.prescribedDate) == 8) {
-            if (p.patientId == patientId) {
+        char line[1024];
+        while (fgets(line, sizeof(line), prescFp)) {
+            if (parsePrescriptionLine(line, &p) && p.patientId == patientId) {
                 char description[100];
                 snprintf(description, sizeof(description), "Prescription: %s (x%d)", p.medicineName, p.quantity);
-                printf("%-30s %-20s %15.2f\n", description, p.prescribedDate, p.totalPrice);
-                medicineCharges += p.totalPrice;
+                formatMoney(p.totalPrice, amount, sizeof(amount));
+                printf("%-30s %-20s %15s\n", description, p.prescribedDate, amount);
+                addReportCharge(&medicineCharges, p.totalPrice);
             }
-            // Skip rest of the line
-            int c;
-            while ((c = fgetc(prescFp)) != '\n' && c != EOF);
         }
         fclose(prescFp);
     }
 
 
     // 3. Calculate Emergency Visit and Medicine Charges
+    refreshEmergencyRecordIndex();
     FILE *emergFp = fopen(EMERGENCY_DATAFILE, "r");
     if (emergFp) {
         char line[1024];
+        long rowOffset = 0;
         while (fgets(line, sizeof(line), emergFp)) {
+            const long rowStart = rowOffset;
+            rowOffset = ftell(emergFp);
+
             int emergId, emergPatientId;
             char arrivalDate[20];
             if (sscanf(line, "%d,%d,%*[^,],%*[^,],%*[^,],%*[^,],%19[^,]", &emergId, &emergPatientId, arrivalDate) == 3) {
-                if (emergPatientId == patientId) {
+                if (emergPatientId == patientId && isCurrentEmergencyRecord(emergId, rowStart)) {
                     char description[100];
                     snprintf(description, sizeof(description), "Emergency Visit (ID: %d)", emergId);
-                    printf("%-30s %-20s %15.2f\n", description, arrivalDate, EMERGENCY_BASE_FEE);
-                    emergencyCharges += EMERGENCY_BASE_FEE;
-
-                    FILE *medFp = fopen(EMERGENCY_MEDICINES_FILE, "r");
-                    if (medFp) {
-                        char medLine[256];
-                        while (fgets(medLine, sizeof(medLine), medFp)) {
-                            int medEmergId, medId, medQty;
-                            if (sscanf(medLine, "%d,%d,%*[^,],%d", &medEmergId, &medId, &medQty) == 3) {
-                                if (medEmergId == emergId) {
-                                    Medicine medInfo = findMedicine(medId);
-                                    if (medInfo.medicineId != 0) {
-                                        double cost = medInfo.price * medQty;
-                                        char medDescription[100];
-                                        snprintf(medDescription, sizeof(medDescription), "  Medicine: %s (x%d)", medInfo.name, medQty);
-                                        printf("%-30s %-20s %15.2f\n", medDescription, arrivalDate, cost);
-                                        medicineCharges += cost;
-                                    }
-                                }
-                            }
+                    formatMoney(EMERGENCY_BASE_FEE, amount, sizeof(amount));
+                    printf("%-30s %-20s %15s\n", description, arrivalDate, amount);
+                    addReportCharge(&emergencyCharges, EMERGENCY_BASE_FEE);
+
+                    EmergencyMedicine medicines[MAX_EMERGENCY_MEDICINES];
+                    const int medicineCount = findEmergencyMedicines(emergId, medicines, MAX_EMERGENCY_MEDICINES);
+                    for (int i = 0; i < medicineCount; i++) {
+                        const BillingPrice* medInfo = findBillingPrice(&engine, medicines[i].medicineId);
+                        if (medInfo) {
+                            const Money cost = medInfo->price * medicines[i].quantity;
+                            char medDescription[100];
+                            snprintf(medDescription, sizeof(medDescription), "  Medicine: %s (x%d)", medInfo->name, medicines[i].quantity);
+                            formatMoney(cost, amount, sizeof(amount));
+                            printf("%-30s %-20s %15s\n", medDescription, arrivalDate, amount);
+                            addReportCharge(&medicineCharges, cost);
                         }
-                        fclose(medFp);
                     }
                 }
             }
         }
         fclose(emergFp);
     }
+    freeBillingEngine(&engine);
 
-    totalBill = appointmentCharges + emergencyCharges + medicineCharges;
+    const Money appointmentTotal = sumMoney(appointmentCharges.amounts, appointmentCharges.count);
+    const Money emergencyTotal = sumMoney(emergencyCharges.amounts, emergencyCharges.count);
+    const Money medicineTotal = sumMoney(medicineCharges.amounts, medicineCharges.count);
+    const Money totalBill = appointmentTotal + emergencyTotal + medicineTotal;
+    free(appointmentCharges.amounts);
+    free(emergencyCharges.amounts);
+    free(medicineCharges.amounts);
 
     printf("--------------------------------------------------------------------------\n");
-    printf("%52s %15.2f\n", "Subtotal Appointments:", appointmentCharges);
-    printf("%52s %15.2f\n", "Subtotal Emergency Visits:", emergencyCharges);
-    printf("%52s %15.2f\n", "Subtotal Medicines:", medicineCharges);
+    formatMoney(appointmentTotal, amount, sizeof(amount));
+    printf("%52s %15s\n", "Subtotal Appointments:", amount);
+    formatMoney(emergencyTotal, amount, sizeof(amount));
+    printf("%52s %15s\n", "Subtotal Emergency Visits:", amount);
+    formatMoney(medicineTotal, amount, sizeof(amount));
+    printf("%52s %15s\n", "Subtotal Medicines:", amount);
     printf("--------------------------------------------------------------------------\n");
-    printf("%52s Tk.%14.2f\n", "TOTAL DUE:", totalBill);
+    formatMoney(totalBill, amount, sizeof(amount));
+    printf("%52s Tk.%14s\n", "TOTAL DUE:", amount);
     printf("--------------------------------------------------------------------------\n");
 
     printf("\nPress Enter to return to menu...");
@@ -512,50 +574,106 @@ void deleteReport() {
     getchar();
 }
 
-static void printPrescriptionHistory(int patientId, FILE* reportFp) {
-    fprintf(reportFp, "----------------------------------------\n");
-    fprintf(reportFp, "       PRESCRIPTION HISTORY\n");
-    fprintf(reportFp, "----------------------------------------\n\n");
+typedef struct {
+    FILE* reportFp;
+    int counts[TIMELINE_SOURCE_COUNT];
+} ProfileTimelineContext;
+
+static void writePrescriptionEvent(char* line, FILE* reportFp) {
+    char *id = strtok(line, ",");
+    strtok(NULL, ","); // patientId
+    strtok(NULL, ","); // medicineId
+    char *medName = strtok(NULL, ",");
+    strtok(NULL, ","); // quantity
+    strtok(NULL, ","); // unitPrice
+    char *totalPrice = strtok(NULL, ",");
+    char *date = strtok(NULL, ",");
+    char *doctor = strtok(NULL, ",");
+    char *dosage = strtok(NULL, ",");
+    char *duration = strtok(NULL, ",");
+    char *notes = strtok(NULL, "\n");
+
+    fprintf(reportFp, "[%s] Prescription ID: %s (Medicine: %s)\n", date, id, medName);
+    fprintf(reportFp, "  Prescribed by: Dr. %s\n", doctor);
+    fprintf(reportFp, "  Dosage: %s\n", dosage);
+    fprintf(reportFp, "  Duration: %s\n", duration);
+    Money total = 0;
+    char amount[MONEY_TEXT_SIZE];
+    if (totalPrice) parseMoney(totalPrice, &total);
+    formatMoney(total, amount, sizeof(amount));
+    fprintf(reportFp, "  Total Price: %s\n", amount);
+    fprintf(reportFp, "  Notes: %s\n\n", notes ? notes : "N/A");
+}
 
-    FILE *prescFp = fopen(PRESCRIPTION_DATAFILE, "r");
-    if (!prescFp) {
-        fprintf(reportFp, "Could not open prescription data file.\n\n");
-        return;
+static void writeEmergencyMedicines(const int emergencyId, FILE* reportFp) {
+    EmergencyMedicine medicines[MAX_EMERGENCY_MEDICINES];
+    const int medicineCount = findEmergencyMedicines(emergencyId, medicines, MAX_EMERGENCY_MEDICINES);
+
+    for (int i = 0; i < medicineCount; i++) {
+        fprintf(reportFp, "    - %s (ID: %d): Qty: %d, Dosage: %s, Instructions: %s\n",
+                medicines[i].medicineName, medicines[i].medicineId, medicines[i].quantity,
+                medicines[i].dosage, medicines[i].instructions[0] ? medicines[i].instructions : "N/A");
+    }
+    if (medicineCount == 0) {
+        fprintf(reportFp, "    - None\n");
     }
+}
 
-    char line[1024];
-    int prescriptionsFound = 0;
-    while (fgets(line, sizeof(line), prescFp)) {
-        int recordPatientId;
-        // Use sscanf to check the patient ID without modifying the line
-        if (sscanf(line, "%*d,%d,", &recordPatientId) == 1 && recordPatientId == patientId) {
-            prescriptionsFound = 1;
-            char *id = strtok(line, ",");
-            strtok(NULL, ","); // patientId
-            char *medId = strtok(NULL, ",");
-            char *medName = strtok(NULL, ",");
-            strtok(NULL, ","); // quantity
-            strtok(NULL, ","); // unitPrice
-            char *totalPrice = strtok(NULL, ",");
-            char *date = strtok(NULL, ",");
-            char *doctor = strtok(NULL, ",");
-            char *dosage = strtok(NULL, ",");
-            char *duration = strtok(NULL, ",");
-            char *notes = strtok(NULL, "\n");
-
-            fprintf(reportFp, "Prescription ID: %s (Medicine: %s)\n", id, medName);
-            fprintf(reportFp, "  Prescribed by: Dr. %s on %s\n", doctor, date);
-            fprintf(reportFp, "  Dosage: %s\n", dosage);
-            fprintf(reportFp, "  Duration: %s\n", duration);
-            fprintf(reportFp, "  Total Price: %.2f\n", atof(totalPrice));
-            fprintf(reportFp, "  Notes: %s\n\n", notes ? notes : "N/A");
-        }
+static void writeEmergencyEvent(char* line, FILE* reportFp) {
+    char *fields[13] = {0};
+    char *token = strtok(line, ",\n");
+    int i = 0;
+    while (token != NULL && i < 13) {
+        fields[i++] = token;
+        token = strtok(NULL, ",\n");
     }
+    if (i < 11) return;
+
+    fprintf(reportFp, "[%s] Emergency ID: %s\n", fields[6], fields[0]);
+    fprintf(reportFp, "  Arrival: %s at %s\n", fields[6], fields[7]);
+    fprintf(reportFp, "  Symptoms: %s\n", fields[4]);
+    fprintf(reportFp, "  Doctor: %s\n", fields[9]);
+    fprintf(reportFp, "  Treatment: %s\n", fields[10]);
+    fprintf(reportFp, "  Status: %s\n", fields[8]);
+    fprintf(reportFp, "  Notes: %s\n", fields[12] ? fields[12] : "N/A");
+    fprintf(reportFp, "  Medicines Prescribed:\n");
+    writeEmergencyMedicines(atoi(fields[0]), reportFp);
+    fprintf(reportFp, "\n");
+}
+
+static void writeAppointmentEvent(char* line, FILE* reportFp) {
+    char *id = strtok(line, ",");
+    strtok(NULL, ","); // patientId
+    char *doctor = strtok(NULL, ",");
+    char *date = strtok(NULL, ",");
+    char *time = strtok(NULL, ",");
+    char *purpose = strtok(NULL, ",");
+    char *status = strtok(NULL, "\n");
+    fprintf(reportFp, "[%s] Appointment ID: %s\n", date, id);
+    fprintf(reportFp, "  Date: %s at %s\n", date, time);
+    fprintf(reportFp, "  Doctor: %s\n", doctor);
+    fprintf(reportFp, "  Purpose: %s\n", purpose);
+    fprintf(reportFp, "  Status: %s\n\n", status);
+}
 
-    if (!prescriptionsFound) {
-        fprintf(reportFp, "No prescription history found.\n\n");
+static void writeProfileTimelineEvent(const TimelineEvent* event, const char* row, void* context) {
+    ProfileTimelineContext* timeline = context;
+    char line[1024];
+    strncpy(line, row, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+
+    switch (event->type) {
+        case TIMELINE_PRESCRIPTION:
+            writePrescriptionEvent(line, timeline->reportFp);
+            break;
+        case TIMELINE_EMERGENCY:
+            writeEmergencyEvent(line, timeline->reportFp);
+            break;
+        case TIMELINE_APPOINTMENT:
+            writeAppointmentEvent(line, timeline->reportFp);
+            break;
     }
-    fclose(prescFp);
+    timeline->counts[event->type]++;
 }
 
 void generatePatientProfileReport() {
@@ -616,45 +734,18 @@ void generatePatientProfileReport() {
     fprintf(reportFp, "Known Allergies: %s\n", patient.allergies);
     fprintf(reportFp, "Primary Doctor: %s\n\n", patient.primaryDoctor);
 
-    // --- Prescription History ---
-    printPrescriptionHistory(patient.patientId, reportFp);
-
-    // --- Emergency Visit History ---
-    printEmergencyHistory(patient.patientId, reportFp);
-
-    // --- Appointment History ---
+    // --- Prescriptions, Emergency Visits and Appointments by date ---
     fprintf(reportFp, "----------------------------------------\n");
-    fprintf(reportFp, "        APPOINTMENT HISTORY\n");
+    fprintf(reportFp, "          MEDICAL TIMELINE\n");
     fprintf(reportFp, "----------------------------------------\n\n");
 
-    FILE *appointmentFp = fopen(APPOINTMENT_DATAFILE, "r");
-    if (appointmentFp) {
-        char line[512];
-        int appointmentsFound = 0;
-        while (fgets(line, sizeof(line), appointmentFp)) {
-            int appPatientId;
-            if (sscanf(line, "%*d,%d,", &appPatientId) == 1 && appPatientId == patient.patientId) {
-                char *id = strtok(line, ",");
-                strtok(NULL, ","); // patientId
-                char *doctor = strtok(NULL, ",");
-                char *date = strtok(NULL, ",");
-                char *time = strtok(NULL, ",");
-                char *purpose = strtok(NULL, ",");
-                char *status = strtok(NULL, "\n");
-                fprintf(reportFp, "Appointment ID: %s\n", id);
-                fprintf(reportFp, "  Date: %s at %s\n", date, time);
-                fprintf(reportFp, "  Doctor: %s\n", doctor);
-                fprintf(reportFp, "  Purpose: %s\n", purpose);
-                fprintf(reportFp, "  Status: %s\n\n", status);
-                appointmentsFound = 1;
-            }
-        }
-        if (!appointmentsFound) {
-            fprintf(reportFp, "No appointment history found.\n\n");
-        }
-        fclose(appointmentFp);
+    ProfileTimelineContext timeline = { reportFp, {0} };
+    if (streamPatientTimeline(patient.patientId, writeProfileTimelineEvent, &timeline) == 0) {
+        fprintf(reportFp, "No prescription, emergency or appointment history found.\n\n");
     } else {
-        fprintf(reportFp, "Could not open appointment data file.\n\n");
+        fprintf(reportFp, "Prescriptions: %d | Emergency Visits: %d | Appointments: %d\n\n",
+                timeline.counts[TIMELINE_PRESCRIPTION], timeline.counts[TIMELINE_EMERGENCY],
+                timeline.counts[TIMELINE_APPOINTMENT]);
     }
 
     fprintf(reportFp, "========================================\n");
@@ -667,88 +758,6 @@ void generatePatientProfileReport() {
     getchar();
 }
 
-static void printEmergencyHistory(int patientId, FILE* reportFp) {
-    fprintf(reportFp, "----------------------------------------\n");
-    fprintf(reportFp, "       EMERGENCY VISIT HISTORY\n");
-    fprintf(reportFp, "----------------------------------------\n\n");
-
-    FILE *emergencyFp = fopen(EMERGENCY_DATAFILE, "r");
-    if (!emergencyFp) {
-        fprintf(reportFp, "No emergency records data file found.\n\n");
-        return;
-    }
-
-    char line[1024];
-    int visitsFound = 0;
-    while (fgets(line, sizeof(line), emergencyFp)) {
-        int recordPatientId, emergencyId;
-        // Create a copy for sscanf to avoid modifying the original line
-        char lineCopyForSscanf[1024];
-        strcpy(lineCopyForSscanf, line);
-
-        if (sscanf(lineCopyForSscanf, "%d,%d,", &emergencyId, &recordPatientId) == 2 && recordPatientId == patientId) {
-            visitsFound = 1;
-            char *fields[13] = {0};
-            // Create a copy for strtok to parse
-            char lineCopyForStrtok[1024];
-            strcpy(lineCopyForStrtok, line);
-            char *token = strtok(lineCopyForStrtok, ",\n");
-            int i = 0;
-            while(token != NULL && i < 13) {
-                fields[i++] = token;
-                token = strtok(NULL, ",\n");
-            }
-
-            fprintf(reportFp, "Emergency ID: %s\n", fields[0]);
-            fprintf(reportFp, "  Arrival: %s at %s\n", fields[6], fields[7]);
-            fprintf(reportFp, "  Symptoms: %s\n", fields[4]);
-            fprintf(reportFp, "  Doctor: %s\n", fields[9]);
-            fprintf(reportFp, "  Treatment: %s\n", fields[10]);
-            fprintf(reportFp, "  Status: %s\n", fields[8]);
-            fprintf(reportFp, "  Notes: %s\n", fields[12] ? fields[12] : "N/A");
-
-            // Now find and print medicines for this emergency ID
-            FILE *medFp = fopen(EMERGENCY_MEDICINES_FILE, "r");
-            if (medFp) {
-                fprintf(reportFp, "  Medicines Prescribed:\n");
-                char medLine[512];
-                int medsFound = 0;
-                while (fgets(medLine, sizeof(medLine), medFp)) {
-                    int medEmergencyId;
-                    if (sscanf(medLine, "%d,", &medEmergencyId) == 1 && medEmergencyId == emergencyId) {
-                        char *medFields[6] = {0};
-                        // Create a copy for strtok
-                        char medLineCopy[512];
-                        strcpy(medLineCopy, medLine);
-                        char *medToken = strtok(medLineCopy, ",\n");
-                        int j = 0;
-                        while(medToken != NULL && j < 6) {
-                            medFields[j++] = medToken;
-                            medToken = strtok(NULL, ",\n");
-                        }
-                        // Format: EmergID,MedID,MedName,Qty,Dosage,Instructions
-                        fprintf(reportFp, "    - %s (ID: %s): Qty: %s, Dosage: %s, Instructions: %s\n",
-                                medFields[2], medFields[1], medFields[3], medFields[4], medFields[5] ? medFields[5] : "N/A");
-                        medsFound = 1;
-                    }
-                }
-                if (!medsFound) {
-                    fprintf(reportFp, "    - None\n");
-                }
-                fclose(medFp);
-            } else {
-                fprintf(reportFp, "    - (Could not open medicine data file)\n");
-            }
-            fprintf(reportFp, "\n");
-        }
-    }
-
-    if (!visitsFound) {
-        fprintf(reportFp, "No emergency visit history found.\n\n");
-    }
-    fclose(emergencyFp);
-}
-
 void reportManagement() {
     int choice;
     initializeDataFiles(); // Ensure all data files exist
@@ -764,7 +773,8 @@ void reportManagement() {
         printf("5. Billing Report\n");
         printf("6. View All Reports\n");
         printf("7. Delete Report\n");
-        printf("8. Back to Main Menu\n");
+        printf("8. Batch Billing (Date Range)\n");
+        printf("9. Back to Main Menu\n");
         printf("\nChoice: ");
 
         if (scanf("%d", &choice) != 1) {
@@ -798,6 +808,9 @@ void reportManagement() {
                 deleteReport();
                 break;
             case 8:
+                runBatchBilling();
+                break;
+            case 9:
                 return;
             default:
                 printf("Invalid choice. Press Enter to continue...");
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rowindex.h"
+
+static void addIndexEntry(RowIndex* index, const int key, const long offset) {
+    if (index->count == index->capacity) {
+        index->capacity = index->capacity ? index->capacity * 2 : 256;
+        index->offsets = realloc(index->offsets, sizeof(long) * index->capacity);
+        index->next = realloc(index->next, sizeof(int) * index->capacity);
+    }
+
+    const int entry = index->count++;
+    index->offsets[entry] = offset;
+    index->next[entry] = -1;
+
+    int tail;
+    if (intMapGet(&index->tails, key, &tail)) {
+        index->next[tail] = entry;
+    } else {
+        intMapPut(&index->heads, key, entry);
+    }
+    intMapPut(&index->tails, key, entry);
+}
+
+static int parseKeyColumn(const char* line, const int keyColumn, int* key) {
+    const char* p = line;
+    for (int column = 0; column < keyColumn; column++) {
+        p = strchr(p, ',');
+        if (!p) return 0;
+        p++;
+    }
+    char* end;
+    const long value = strtol(p, &end, 10);
+    if (end == p) return 0;
+    *key = (int)value;
+    return 1;
+}
+
+// Index every complete row from index->indexedSize to the end of the file
+static void scanRowIndexTail(RowIndex* index, FILE* fp) {
+    fseek(fp, index->indexedSize, SEEK_SET);
+
+    char line[1024];
+    long rowStart = index->indexedSize;
+    int atRowStart = 1;
+    int key;
+
+    while (fgets(line, sizeof(line), fp)) {
+        const int isComplete = strchr(line, '\n') != NULL;
+        if (atRowStart && parseKeyColumn(line, index->keyColumn, &key)) {
+            addIndexEntry(index, key, rowStart);
+        }
+        if (isComplete) {
+            rowStart = ftell(fp);
+            index->indexedSize = rowStart;
+        }
+        atRowStart = isComplete;
+    }
+}
+
+static void refreshRowIndex(RowIndex* index) {
+    FILE *fp = fopen(index->path, "r");
+    if (!fp) {
+        invalidateRowIndex(index);
+        index->isBuilt = 1;
+        return;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+
+    // A file that shrank was rewritten behind our back
+    if (!index->isBuilt || size < index->indexedSize) {
+        invalidateRowIndex(index);
+        index->isBuilt = 1;
+    }
+    if (size > index->indexedSize) {
+        scanRowIndexTail(index, fp);
+    }
+    fclose(fp);
+}
+
+void invalidateRowIndex(RowIndex* index) {
+    clearIntMap(&index->heads);
+    clearIntMap(&index->tails);
+    index->count = 0;
+    index->indexedSize = 0;
+    index->isBuilt = 0;
+}
+
+// Record a row the caller just appended. Rows appended by someone else in
+// between are picked up by the next tail scan instead.
+void noteRowAppended(RowIndex* index, const int key, const long offset, const long endOffset) {
+    if (!index->isBuilt || offset != index->indexedSize) return;
+    addIndexEntry(index, key, offset);
+    index->indexedSize = endOffset;
+}
+
+int firstIndexedRow(RowIndex* index, const int key) {
+    refreshRowIndex(index);
+
+    int entry;
+    if (!intMapGet(&index->heads, key, &entry)) return -1;
+    return entry;
+}
+
+int nextIndexedRow(const RowIndex* index, const int entry) {
+    return index->next[entry];
+}
+
+long indexedRowOffset(const RowIndex* index, const int entry) {
+    return index->offsets[entry];
+}
+
+int readRowAt(FILE* fp, const long offset, char* line, const int size) {
+    if (fseek(fp, offset, SEEK_SET) != 0) return 0;
+    return fgets(line, size, fp) != NULL;
+}
@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include <string.h>
+#include "skiplist.h"
+
+static int comparePair(const IntSkipListNode* node, const int key, const int value) {
+    if (node->key != key) return node->key < key ? -1 : 1;
+    if (node->value != value) return node->value < value ? -1 : 1;
+    return 0;
+}
+
+// Each level up holds a quarter of the nodes of the one below
+static int randomLevel(IntSkipList* list) {
+    if (list->seed == 0) list->seed = 0x9e3779b9U;
+
+    int level = 1;
+    while (level < SKIPLIST_MAX_LEVEL) {
+        unsigned int x = list->seed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        list->seed = x;
+        if ((x & 3) != 0) break;
+        level++;
+    }
+    return level;
+}
+
+// The next pointer at `level` of `node`, or of the head when node is NULL
+static IntSkipListNode** nextSlot(IntSkipList* list, IntSkipListNode* node, const int level) {
+    return node ? &node->next[level] : &list->head[level];
+}
+
+// Fill `before` with the last node at each level ordered before (key, value)
+static void findPredecessors(IntSkipList* list, const int key, const int value,
+                             IntSkipListNode* before[SKIPLIST_MAX_LEVEL]) {
+    IntSkipListNode* node = NULL;
+    for (int level = list->level - 1; level >= 0; level--) {
+        IntSkipListNode* next;
+        while ((next = *nextSlot(list, node, level)) && comparePair(next, key, value) < 0) {
+            node = next;
+        }
+        before[level] = node;
+    }
+}
+
+void clearIntSkipList(IntSkipList* list) {
+    IntSkipListNode* node = list->head[0];
+    while (node) {
+        IntSkipListNode* next = node->next[0];
+        free(node);
+        node = next;
+    }
+    memset(list->head, 0, sizeof(list->head));
+    list->level = 0;
+    list->count = 0;
+}
+
+void intSkipListInsert(IntSkipList* list, const int key, const int value) {
+    IntSkipListNode* before[SKIPLIST_MAX_LEVEL];
+    findPredecessors(list, key, value, before);
+
+    const int level = randomLevel(list);
+    while (list->level < level) before[list->level++] = NULL;
+
+    IntSkipListNode* node = malloc(sizeof(IntSkipListNode) + sizeof(IntSkipListNode*) * level);
+    node->key = key;
+    node->value = value;
+    node->level = level;
+    for (int i = 0; i < level; i++) {
+        IntSkipListNode** slot = nextSlot(list, before[i], i);
+        node->next[i] = *slot;
+        *slot = node;
+    }
+    list->count++;
+}
+
+// Remove one (key, value) pair. Returns 0 if it was not in the list.
+int intSkipListRemove(IntSkipList* list, const int key, const int value) {
+    IntSkipListNode* before[SKIPLIST_MAX_LEVEL];
+    findPredecessors(list, key, value, before);
+
+    IntSkipListNode* node = list->level > 0 ? *nextSlot(list, before[0], 0) : NULL;
+    if (!node || comparePair(node, key, value) != 0) return 0;
+
+    for (int i = 0; i < node->level; i++) {
+        *nextSlot(list, before[i], i) = node->next[i];
+    }
+    free(node);
+    while (list->level > 0 && !list->head[list->level - 1]) list->level--;
+    list->count--;
+    return 1;
+}
+
+const IntSkipListNode* intSkipListFirst(const IntSkipList* list) {
+    return list->head[0];
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stock_ledger.h"
+
+#ifndef _WIN32
+#include <sys/file.h>
+#endif
+
+#define STOCK_LEDGER_FILE "data/medicine_ledger.csv"
+#define STOCK_LEDGER_ROW_SIZE 48          // Longest formatted movement row
+
+// Open the ledger and hold its lock until closeStockLedger(). Anything that
+// must see or make stock changes consistently across terminals happens in
+// between. Only one terminal runs on Windows, so there is no lock there.
+// Returns NULL if the ledger cannot be opened.
+FILE* openStockLedger() {
+    FILE *fp = fopen(STOCK_LEDGER_FILE, "a+");
+    if (!fp) return NULL;
+#ifndef _WIN32
+    flock(fileno(fp), LOCK_EX);
+#endif
+    return fp;
+}
+
+void closeStockLedger(FILE* ledger) {
+#ifndef _WIN32
+    flock(fileno(ledger), LOCK_UN);
+#endif
+    fclose(ledger);
+}
+
+// Read the next movement, skipping malformed rows. Returns 0 at the end of
+// the ledger or at a partial row still being written, leaving the file
+// position just past the last complete row read.
+int readStockMovement(FILE* ledger, StockMovement* movement) {
+    char line[96];
+    long rowStart = ftell(ledger);
+    while (fgets(line, sizeof(line), ledger)) {
+        if (!strchr(line, '\n')) {
+            fseek(ledger, rowStart, SEEK_SET);
+            return 0;
+        }
+
+        long timestamp;
+        char type;
+        if (sscanf(line, "%ld,%c,%d,%d", &timestamp, &type, &movement->medicineId, &movement->quantity) == 4) {
+            movement->timestamp = (time_t)timestamp;
+            movement->type = (StockMovementType)type;
+            return 1;
+        }
+        rowStart = ftell(ledger);
+    }
+    return 0;
+}
+
+// Append `count` movements of one type stamped with the current time, with
+// a single write so a whole shipment lands at once. Caller holds the lock,
+// which keeps the ledger in time order. Returns the ledger size after
+// them, or -1 if they could not all be written.
+long appendStockMovements(FILE* ledger, const StockMovementType type, const int* medicineIds,
+                          const int* quantities, const int count) {
+    char* rows = malloc((size_t)count * STOCK_LEDGER_ROW_SIZE + 1);
+    if (!rows) return -1;
+
+    const long now = (long)time(NULL);
+    int length = 0;
+    for (int i = 0; i < count; i++) {
+        length += snprintf(rows + length, STOCK_LEDGER_ROW_SIZE + 1, "%ld,%c,%d,%d\n",
+                           now, (char)type, medicineIds[i], quantities[i]);
+    }
+
+    fseek(ledger, 0, SEEK_END);
+    const int isWritten = fwrite(rows, 1, length, ledger) == (size_t)length && fflush(ledger) == 0;
+    free(rows);
+    return isWritten ? ftell(ledger) : -1;
+}
+
+long appendStockMovement(FILE* ledger, const StockMovementType type, const int medicineId, const int quantity) {
+    return appendStockMovements(ledger, type, &medicineId, &quantity, 1);
+}
+
+// Move to the first row starting at or after byte `position`
+static void seekRowAtOrAfter(FILE* ledger, const long position) {
+    if (position == 0) {
+        rewind(ledger);
+        return;
+    }
+
+    // Finish the row holding byte position-1, in pieces if it is long
+    char skipped[96];
+    fseek(ledger, position - 1, SEEK_SET);
+    while (fgets(skipped, sizeof(skipped), ledger) && !strchr(skipped, '\n')) {}
+}
+
+// Leave the ledger at the first movement at or after `from`. The ledger is
+// in time order, so this is a binary search over byte positions: the first
+// position whose next row is at or after `from`.
+static void seekFirstMovementFrom(FILE* ledger, const time_t from) {
+    fseek(ledger, 0, SEEK_END);
+    long low = 0, high = ftell(ledger);
+    while (low < high) {
+        const long mid = low + (high - low) / 2;
+        StockMovement movement;
+        seekRowAtOrAfter(ledger, mid);
+        if (!readStockMovement(ledger, &movement) || movement.timestamp >= from) high = mid;
+        else low = mid + 1;
+    }
+    seekRowAtOrAfter(ledger, low);
+}
+
+// Visit every movement in [from, to), oldest first, skipping snapshot
+// rows. Returns the number of movements visited.
+int scanStockMovements(const time_t from, const time_t to, void (*visit)(const StockMovement*, void*), void* context) {
+    FILE *fp = fopen(STOCK_LEDGER_FILE, "r");
+    if (!fp) return 0;
+    seekFirstMovementFrom(fp, from);
+
+    int visited = 0;
+    StockMovement movement;
+    while (readStockMovement(fp, &movement) && movement.timestamp < to) {
+        if (movement.type == STOCK_SNAPSHOT) continue;
+        visit(&movement, context);
+        visited++;
+    }
+    fclose(fp);
+    return visited;
+}
+
+typedef struct {
+    int medicineId;
+    StockMovementTotals* totals;
+} TotalsContext;
+
+static void addToTotals(const StockMovement* movement, void* context) {
+    const TotalsContext* totalsContext = context;
+    if (movement->medicineId != totalsContext->medicineId) return;
+
+    StockMovementTotals* totals = totalsContext->totals;
+    switch (movement->type) {
+        case STOCK_RECEIPT: totals->received += movement->quantity; break;
+        case STOCK_DISPENSE: totals->dispensed -= movement->quantity; break;
+        case STOCK_ADJUSTMENT: totals->adjusted += movement->quantity; break;
+        case STOCK_EXPIRY: totals->expired -= movement->quantity; break;
+        default: return;
+    }
+    totals->movementCount++;
+}
+
+// Units received, dispensed, adjusted and expired for one medicine in
+// [from, to). Returns the number of its movements in the range.
+int getStockMovementTotals(const int medicineId, const time_t from, const time_t to, StockMovementTotals* totals) {
+    memset(totals, 0, sizeof(*totals));
+    TotalsContext context = {medicineId, totals};
+    scanStockMovements(from, to, addToTotals, &context);
+    return totals->movementCount;
+}
+
+const char* getStockMovementTypeString(const StockMovementType type) {
+    switch (type) {
+        case STOCK_RECEIPT: return "Receipt";
+        case STOCK_DISPENSE: return "Dispense";
+        case STOCK_ADJUSTMENT: return "Adjustment";
+        case STOCK_EXPIRY: return "Expiry";
+        case STOCK_SNAPSHOT: return "Snapshot";
+        default: return "Unknown";
+    }
+}
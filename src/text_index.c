@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "text_index.h"
+#include "hashmap.h"
+
+static int addNode(TextIndex* index, const char label) {
+    if (index->nodeCount == index->nodeCapacity) {
+        index->nodeCapacity = index->nodeCapacity ? index->nodeCapacity * 2 : 256;
+        index->nodes = realloc(index->nodes, sizeof(TextIndexNode) * index->nodeCapacity);
+    }
+    TextIndexNode* node = &index->nodes[index->nodeCount];
+    node->firstChild = -1;
+    node->nextSibling = -1;
+    node->firstPosting = -1;
+    node->label = label;
+    return index->nodeCount++;
+}
+
+static int findOrAddChild(TextIndex* index, const int parent, const char label) {
+    for (int child = index->nodes[parent].firstChild; child >= 0; child = index->nodes[child].nextSibling) {
+        if (index->nodes[child].label == label) return child;
+    }
+
+    const int child = addNode(index, label);
+    index->nodes[child].nextSibling = index->nodes[parent].firstChild;
+    index->nodes[parent].firstChild = child;
+    return child;
+}
+
+static void addPosting(TextIndex* index, const int node, const int id, const int field,
+                       const int position, const int isWordStart) {
+    if (index->postingCount == index->postingCapacity) {
+        index->postingCapacity = index->postingCapacity ? index->postingCapacity * 2 : 256;
+        index->postings = realloc(index->postings, sizeof(TextIndexPosting) * index->postingCapacity);
+    }
+    TextIndexPosting* posting = &index->postings[index->postingCount];
+    posting->id = id;
+    posting->field = (unsigned char)field;
+    posting->position = (unsigned char)(position < 255 ? position : 255);
+    posting->isWordStart = (unsigned char)isWordStart;
+    posting->next = index->nodes[node].firstPosting;
+    index->nodes[node].firstPosting = index->postingCount++;
+}
+
+void clearTextIndex(TextIndex* index) {
+    index->nodeCount = 0;
+    index->postingCount = 0;
+}
+
+void addTextIndexEntry(TextIndex* index, const char* text, const int id, const int field) {
+    if (index->nodeCount == 0) addNode(index, '\0');
+
+    const int length = (int)strlen(text);
+    for (int start = 0; start < length; start++) {
+        if (isspace((unsigned char)text[start])) continue;
+
+        int node = 0;
+        for (int i = start; i < length; i++) {
+            node = findOrAddChild(index, node, (char)tolower((unsigned char)text[i]));
+        }
+        const int isWordStart = start == 0 || !isalnum((unsigned char)text[start - 1]);
+        addPosting(index, node, id, field, start, isWordStart);
+    }
+}
+
+typedef struct {
+    const TextIndex* index;
+    char query[TEXT_INDEX_MAX_QUERY];
+    int queryLength;
+    int maxEdits;
+    IntMap bestSlot;            // id -> slot in matches
+    TextMatch* matches;
+    int matchCount;
+    int matchCapacity;
+} TextSearch;
+
+static int compareMatches(const TextMatch* a, const TextMatch* b) {
+    if (a->edits != b->edits) return a->edits - b->edits;
+    if (a->field != b->field) return a->field - b->field;
+    if (a->matchKind != b->matchKind) return a->matchKind - b->matchKind;
+    return a->id - b->id;
+}
+
+static int compareMatchesForSort(const void* a, const void* b) {
+    return compareMatches(a, b);
+}
+
+static void offerMatch(TextSearch* search, const TextMatch* match) {
+    int slot;
+    if (intMapGet(&search->bestSlot, match->id, &slot)) {
+        if (compareMatches(match, &search->matches[slot]) < 0) search->matches[slot] = *match;
+        return;
+    }
+
+    if (search->matchCount == search->matchCapacity) {
+        search->matchCapacity = search->matchCapacity ? search->matchCapacity * 2 : 64;
+        search->matches = realloc(search->matches, sizeof(TextMatch) * search->matchCapacity);
+    }
+    search->matches[search->matchCount] = *match;
+    intMapPut(&search->bestSlot, match->id, search->matchCount);
+    search->matchCount++;
+}
+
+// Every suffix below `node` starts with the matched text
+static void collectSubtree(TextSearch* search, const int node, const int edits) {
+    const TextIndex* index = search->index;
+    for (int p = index->nodes[node].firstPosting; p >= 0; p = index->postings[p].next) {
+        const TextIndexPosting* posting = &index->postings[p];
+        TextMatch match = {posting->id, edits, posting->field, posting->position == 0 ? 0 : posting->isWordStart ? 1 : 2};
+        offerMatch(search, &match);
+    }
+    for (int child = index->nodes[node].firstChild; child >= 0; child = index->nodes[child].nextSibling) {
+        collectSubtree(search, child, edits);
+    }
+}
+
+// Levenshtein walk: `previous` holds the edit distances between each query
+// prefix and the text spelled by the parent of `node`
+static void searchFrom(TextSearch* search, const int node, const int* previous) {
+    const int length = search->queryLength;
+    const char label = search->index->nodes[node].label;
+
+    int row[TEXT_INDEX_MAX_QUERY + 1];
+    row[0] = previous[0] + 1;
+    int best = row[0];
+    for (int j = 1; j <= length; j++) {
+        const int substitute = previous[j - 1] + (search->query[j - 1] != label);
+        const int insert = row[j - 1] + 1;
+        const int remove = previous[j] + 1;
+        row[j] = substitute < insert ? substitute : insert;
+        if (remove < row[j]) row[j] = remove;
+        if (row[j] < best) best = row[j];
+    }
+
+    if (row[length] <= search->maxEdits) collectSubtree(search, node, row[length]);
+    if (best > search->maxEdits) return;
+
+    for (int child = search->index->nodes[node].firstChild; child >= 0; child = search->index->nodes[child].nextSibling) {
+        searchFrom(search, child, row);
+    }
+}
+
+// Entries containing `query`, allowing up to maxEdits typos, best first:
+// fewer typos, then lower field, then prefix before word start before
+// anywhere. Returns how many were stored in `matches`.
+int searchTextIndex(const TextIndex* index, const char* query, const int maxEdits,
+                    TextMatch* matches, const int maxMatches) {
+    TextSearch search = {0};
+    search.index = index;
+    search.maxEdits = maxEdits;
+    for (const char* c = query; *c && search.queryLength < TEXT_INDEX_MAX_QUERY - 1; c++) {
+        search.query[search.queryLength++] = (char)tolower((unsigned char)*c);
+    }
+    if (search.queryLength == 0 || index->nodeCount == 0) return 0;
+
+    int root[TEXT_INDEX_MAX_QUERY + 1];
+    for (int j = 0; j <= search.queryLength; j++) root[j] = j;
+    for (int child = index->nodes[0].firstChild; child >= 0; child = index->nodes[child].nextSibling) {
+        searchFrom(&search, child, root);
+    }
+
+    if (search.matchCount > 1) qsort(search.matches, search.matchCount, sizeof(TextMatch), compareMatchesForSort);
+    const int count = search.matchCount < maxMatches ? search.matchCount : maxMatches;
+    if (count > 0) memcpy(matches, search.matches, sizeof(TextMatch) * count);
+
+    free(search.matches);
+    freeIntMap(&search.bestSlot);
+    return count;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timeline.h"
+#include "appointment.h"
+#include "prescription.h"
+#include "emergency.h"
+#include "emergency_records.h"
+#include "dateutil.h"
+
+#define TIMELINE_ROW_SIZE 1024
+
+typedef struct {
+    RowIndex* index;
+    int dateColumn;
+    int timeColumn;         // -1 when the table has no time column
+    int (*isCurrentRow)(const char* row, long offset);  // NULL when every row is current
+    FILE* fp;
+    TimelineEvent* events;
+    int count;
+    int position;
+} TimelineSource;
+
+// Copy CSV column `column` of `row` into dest
+static void copyColumn(const char* row, const int column, char* dest, const size_t size) {
+    const char* p = row;
+    for (int i = 0; i < column && p; i++) {
+        p = strchr(p, ',');
+        if (p) p++;
+    }
+    dest[0] = '\0';
+    if (!p) return;
+
+    size_t len = strcspn(p, ",\r\n");
+    if (len >= size) len = size - 1;
+    memcpy(dest, p, len);
+    dest[len] = '\0';
+}
+
+static int packTime(const char* time) {
+    int hours = 0, minutes = 0, seconds = 0;
+    if (sscanf(time, "%d:%d:%d", &hours, &minutes, &seconds) < 2) return 0;
+    return hours * 10000 + minutes * 100 + seconds;
+}
+
+static int compareTimelineEvents(const TimelineEvent* a, const TimelineEvent* b) {
+    if (a->date != b->date) return a->date < b->date ? -1 : 1;
+    if (a->time != b->time) return a->time < b->time ? -1 : 1;
+    if (a->offset != b->offset) return a->offset < b->offset ? -1 : 1;
+    return 0;
+}
+
+static int compareTimelineEventsQsort(const void* a, const void* b) {
+    return compareTimelineEvents(a, b);
+}
+
+// One index probe: collect and order this table's events for the patient
+static void loadTimelineSource(TimelineSource* source, const TimelineEventType type, const int patientId) {
+    source->events = NULL;
+    source->count = 0;
+    source->position = 0;
+    source->fp = fopen(source->index->path, "r");
+    if (!source->fp) return;
+
+    int capacity = 0;
+    char row[TIMELINE_ROW_SIZE];
+    char field[32];
+
+    for (int entry = firstIndexedRow(source->index, patientId); entry >= 0;
+         entry = nextIndexedRow(source->index, entry)) {
+        const long offset = indexedRowOffset(source->index, entry);
+        if (!readRowAt(source->fp, offset, row, sizeof(row)) ||
+            (source->isCurrentRow && !source->isCurrentRow(row, offset))) {
+            continue;
+        }
+
+        // The index may be stale if another terminal rewrote the file
+        copyColumn(row, source->index->keyColumn, field, sizeof(field));
+        if (atoi(field) != patientId) continue;
+
+        if (source->count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            source->events = realloc(source->events, sizeof(TimelineEvent) * capacity);
+        }
+
+        TimelineEvent* event = &source->events[source->count++];
+        event->type = type;
+        event->offset = offset;
+        copyColumn(row, source->dateColumn, field, sizeof(field));
+        event->date = packDate(field);
+        event->time = 0;
+        if (source->timeColumn >= 0) {
+            copyColumn(row, source->timeColumn, field, sizeof(field));
+            event->time = packTime(field);
+        }
+    }
+
+    qsort(source->events, source->count, sizeof(TimelineEvent), compareTimelineEventsQsort);
+}
+
+// Merge appointments, prescriptions and emergency visits for a patient by
+// date and hand each one to the writer. Returns the number of events.
+int streamPatientTimeline(const int patientId, const TimelineWriter writer, void* context) {
+    TimelineSource sources[TIMELINE_SOURCE_COUNT] = {
+        [TIMELINE_APPOINTMENT] = { getAppointmentPatientIndex(), 3, 4, NULL },
+        [TIMELINE_PRESCRIPTION] = { getPrescriptionPatientIndex(), 7, -1, NULL },
+        [TIMELINE_EMERGENCY] = { getEmergencyPatientIndex(), 6, 7, isCurrentEmergencyRow },
+    };
+    refreshEmergencyRecordIndex();
+
+    for (int i = 0; i < TIMELINE_SOURCE_COUNT; i++) {
+        loadTimelineSource(&sources[i], (TimelineEventType)i, patientId);
+    }
+
+    int emitted = 0;
+    char row[TIMELINE_ROW_SIZE];
+    while (1) {
+        TimelineSource* next = NULL;
+        for (int i = 0; i < TIMELINE_SOURCE_COUNT; i++) {
+            TimelineSource* source = &sources[i];
+            if (source->position >= source->count) continue;
+            if (!next || compareTimelineEvents(&source->events[source->position],
+                                               &next->events[next->position]) < 0) {
+                next = source;
+            }
+        }
+        if (!next) break;
+
+        const TimelineEvent* event = &next->events[next->position++];
+        if (readRowAt(next->fp, event->offset, row, sizeof(row))) {
+            writer(event, row, context);
+            emitted++;
+        }
+    }
+
+    for (int i = 0; i < TIMELINE_SOURCE_COUNT; i++) {
+        free(sources[i].events);
+        if (sources[i].fp) fclose(sources[i].fp);
+    }
+    return emitted;
+}